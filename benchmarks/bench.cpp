@@ -0,0 +1,521 @@
+#include <aOpenGL.h>
+#include <aOpenGL/core/mesh.h>
+#include <aOpenGL/core/meshopt.h>
+#include "fbx/keyframe.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Microbenchmarks for kinematics, skinning and keyframe resampling.
+// Synthetic skeletons and motions: no FBX file, no window, no GPU.
+//
+// usage: ./bench [output.json] [--filter name] [--min-time sec]
+
+using namespace a::gl;
+using Clock = std::chrono::steady_clock;
+
+// keep the result alive without a side effect
+template<typename T>
+static void do_not_optimize(const T& value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    static volatile const void* sink;
+    sink = &value;
+#endif
+}
+
+struct Result
+{
+    std::string name;
+    long long   iterations;
+    double      ns_median;
+    double      ns_min;
+    double      ns_max;
+};
+
+struct Options
+{
+    std::string output;
+    std::string filter;
+    double      min_time{0.3};
+};
+
+static std::vector<Result> results;
+static Options options;
+
+/**
+ * @brief run func in batches until min_time has passed. ns per call of each batch -> median / min / max
+ */
+static void run(const std::string& name, const std::function<void()>& func)
+{
+    if(options.filter.empty() == false && name.find(options.filter) == std::string::npos)
+        return;
+
+    // warm up and pick a batch size of about 10ms
+    long long batch = 1;
+    while(true)
+    {
+        auto begin = Clock::now();
+        for(long long i = 0; i < batch; ++i)
+            func();
+        double sec = std::chrono::duration<double>(Clock::now() - begin).count();
+        if(sec > 0.01 || batch >= (1LL << 30))
+            break;
+        batch *= 2;
+    }
+
+    std::vector<double> samples;
+    long long iterations = 0;
+    auto start = Clock::now();
+    while(samples.size() < 5 || std::chrono::duration<double>(Clock::now() - start).count() < options.min_time)
+    {
+        auto begin = Clock::now();
+        for(long long i = 0; i < batch; ++i)
+            func();
+        double ns = std::chrono::duration<double, std::nano>(Clock::now() - begin).count();
+        samples.push_back(ns / batch);
+        iterations += batch;
+    }
+
+    std::sort(samples.begin(), samples.end());
+    Result r{name, iterations, samples[samples.size() / 2], samples.front(), samples.back()};
+    results.push_back(r);
+
+    std::cerr << name << ": " << r.ns_median << " ns (min " << r.ns_min << ", " << r.iterations << " iterations)" << std::endl;
+}
+
+// synthetic data -------------------------------------------------- //
+
+static std::mt19937 rng(1234);
+
+static float uniform(float lo, float hi)
+{
+    return std::uniform_real_distribution<float>(lo, hi)(rng);
+}
+
+static Quat random_rot(float max_angle)
+{
+    Vec3 axis(uniform(-1, 1), uniform(-1, 1), uniform(-1, 1));
+    return Quat(Eigen::AngleAxisf(uniform(-max_angle, max_angle), axis.normalized()));
+}
+
+/**
+ * @brief humanoid-like tree: root + spine chain with limbs. about 65 joints like a mixamo rig.
+ */
+static spModel synthetic_model(int chain_num = 8, int chain_length = 8)
+{
+    std::vector<spJoint> joints;
+
+    auto add_joint = [&](const std::string& name, spJoint parent, const Vec3& offset)
+    {
+        auto joint = std::make_shared<Joint>();
+        joint->set_name(name);
+        joint->set_local_pos(offset);
+        if(parent)
+        {
+            joint->set_parent(parent);
+            parent->add_child(joint);
+        }
+        joints.push_back(joint);
+        return joint;
+    };
+
+    auto root = add_joint("root", nullptr, Vec3(0, 100, 0));
+    for(int c = 0; c < chain_num; ++c)
+    {
+        auto parent = root;
+        Vec3 dir(std::cos(c * 0.8f), std::sin(c * 0.8f), 0.3f);
+        for(int j = 0; j < chain_length; ++j)
+            parent = add_joint("chain" + std::to_string(c) + "_" + std::to_string(j), parent, 10.0f * dir.normalized());
+    }
+    root->update_world_trf_children();
+
+    // skinned mesh without GL buffers: one bind matrix per joint
+    auto meshGL = std::make_shared<core::MeshGL>();
+    meshGL->is_skinned = true;
+    for(int i = 0; i < (int)joints.size(); ++i)
+    {
+        meshGL->joint_order.push_back(joints[i]->name());
+        meshGL->name_to_idx[joints[i]->name()] = i;
+        meshGL->jonit_bind_trf_inv.push_back(glm::inverse(to_glm(joints[i]->world_trf())));
+    }
+    meshGL->skin_radius = 10.0f;
+
+    std::vector<std::pair<core::spMeshGL, vMaterial>> meshes = { {meshGL, vMaterial()} };
+    return std::make_shared<Model>(joints, meshes);
+}
+
+static Motion synthetic_motion(const spModel& model, int frame_num)
+{
+    Motion motion;
+    motion.name = "synthetic";
+    motion.start_time = 0.0f;
+    motion.end_time = frame_num / 30.0f;
+    motion.fps = 30.0f;
+
+    int noj = (int)model->joints().size();
+    std::vector<Quat> base(noj), delta(noj);
+    for(int j = 0; j < noj; ++j)
+    {
+        base[j] = random_rot(0.5f);
+        delta[j] = random_rot(0.05f);
+    }
+
+    motion.poses.resize(frame_num);
+    Quat yaw = Quat::Identity();
+    for(int f = 0; f < frame_num; ++f)
+    {
+        auto& pose = motion.poses[f];
+        pose.root_position = Vec3(0.5f * f, 100.0f + std::sin(0.2f * f), 0.3f * f);
+        pose.local_rotations.resize(noj);
+        for(int j = 0; j < noj; ++j)
+            base[j] = (base[j] * delta[j]).normalized();
+
+        // slow turn of the root so the basis filter has something to do
+        yaw = (yaw * Quat(Eigen::AngleAxisf(0.01f, Vec3::UnitY()))).normalized();
+        pose.local_rotations = base;
+        pose.local_rotations[0] = yaw * base[0];
+    }
+    return motion;
+}
+
+static std::vector<KeyFrame> synthetic_curve(int key_num, float duration)
+{
+    std::vector<KeyFrame> keys(key_num);
+    for(int i = 0; i < key_num; ++i)
+    {
+        keys[i].time = duration * i / (key_num - 1);
+        keys[i].value = 90.0f * std::sin(3.0f * keys[i].time) + uniform(-1, 1);
+        keys[i].type = KeyInterpType::kLinear;
+    }
+    return keys;
+}
+
+/**
+ * @brief skinned grid as the fbx parser emits it: 3 unique vertices per triangle
+ */
+static void synthetic_soup(int n, std::vector<core::VertexGL>& vertices, std::vector<unsigned int>& indices)
+{
+    auto vertex = [n](int x, int y)
+    {
+        core::VertexGL v{};
+        v.position = glm::vec3(x, 0.1f * std::sin(0.3f * x + 0.2f * y), y);
+        v.normal = glm::vec3(0, 1, 0);
+        v.uv = glm::vec2(x / (float)n, y / (float)n);
+        v.tangent = glm::vec3(1, 0, 0);
+        v.bitangent = glm::vec3(0, 0, 1);
+        v.skinning_idxes = glm::vec4(x / 8, x / 8 + 1, 0, 0);
+        v.skinning_weights = glm::vec4(1.0f - (x % 8) / 8.0f, (x % 8) / 8.0f, 0, 0);
+        return v;
+    };
+
+    vertices.clear();
+    indices.clear();
+    for(int y = 0; y < n; ++y)
+    {
+        for(int x = 0; x < n; ++x)
+        {
+            for(auto c : {glm::ivec2(0, 0), glm::ivec2(1, 0), glm::ivec2(1, 1), glm::ivec2(0, 0), glm::ivec2(1, 1), glm::ivec2(0, 1)})
+            {
+                indices.push_back((unsigned int)vertices.size());
+                vertices.push_back(vertex(x + c.x, y + c.y));
+            }
+        }
+    }
+}
+
+// output ---------------------------------------------------------- //
+
+static void write_json(std::ostream& out)
+{
+    out << "{\n  \"context\": {\"threads\": " << std::thread::hardware_concurrency()
+        << ", \"min_time\": " << options.min_time << "},\n  \"benchmarks\": [\n";
+    for(size_t i = 0; i < results.size(); ++i)
+    {
+        const auto& r = results[i];
+        out << "    {\"name\": \"" << r.name << "\", \"iterations\": " << r.iterations
+            << ", \"ns_median\": " << r.ns_median << ", \"ns_min\": " << r.ns_min << ", \"ns_max\": " << r.ns_max << "}"
+            << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n}\n";
+}
+
+int main(int argc, char* argv[])
+{
+    for(int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if(arg == "--filter" && i + 1 < argc)
+            options.filter = argv[++i];
+        else if(arg == "--min-time" && i + 1 < argc)
+            options.min_time = std::atof(argv[++i]);
+        else
+            options.output = arg;
+    }
+
+    auto model = synthetic_model();
+    auto motion = synthetic_motion(model, 300);
+    int noj = (int)model->joints().size();
+    std::cerr << "synthetic skeleton: " << noj << " joints, " << motion.poses.size() << " frames" << std::endl;
+
+    auto kmodel = kinmodel(model);
+    auto kmotion = kinmotion(kmodel, std::vector<Motion>{motion});
+
+    // kinematics
+    {
+        const auto& pose = kmotion->poses.at(10);
+        run("kin::compute_fk/mat4", [&]{
+            auto trfs = kin::compute_fk(kmodel, pose.world_basisTrf, pose.local_pos, pose.local_rots);
+            do_not_optimize(trfs);
+        });
+
+        std::vector<Quat> rots = motion.poses.at(10).local_rotations;
+        run("kin::compute_fk/quat", [&]{
+            auto trfs = kin::compute_fk(kmodel, Mat4::Identity(), pose.local_pos, rots);
+            do_not_optimize(trfs);
+        });
+
+        std::vector<Motion> motions{motion};
+        run("kinmotion/300_frames", [&]{
+            auto km = kinmotion(kmodel, motions);
+            do_not_optimize(km);
+        });
+
+        run("apply_basisTrf_filter/300_frames", [&]{
+            auto km = std::make_shared<KinMotion>(*kmotion);
+            kin::apply_basisTrf_filter(km, 3);
+            do_not_optimize(km);
+        });
+    }
+
+    // compressed motion
+    {
+        std::vector<Motion> motions{motion};
+        run("kincompressed/300_frames", [&]{
+            auto cm = kincompressed(kmodel, motions);
+            do_not_optimize(cm);
+        });
+
+        auto cmotion = kincompressed(kmodel, motions);
+        std::cerr << "kincompressed: " << cmotion->byte_size() << " / " << cmotion->raw_byte_size() << " bytes, error "
+                  << cmotion->position_errors.at(0) << std::endl;
+
+        Vec3 root_position;
+        std::vector<Quat> local_rots;
+        int pidx = 0;
+        run("KinCompressedMotion::decompress/pose", [&]{
+            pidx = (pidx + 37) % cmotion->pose_n;
+            cmotion->decompress(pidx, root_position, local_rots);
+            do_not_optimize(local_rots);
+        });
+    }
+
+    // model & skinning
+    {
+        int frame = 0;
+        run("Model::set_pose", [&]{
+            model->set_pose(motion.poses[frame]);
+            frame = (frame + 1) % (int)motion.poses.size();
+        });
+
+        auto mesh = model->mesh(0);
+        run("Mesh::update_mesh", [&]{
+            mesh->update_mesh();
+        });
+
+        std::vector<core::VertexGL> soup, vertices;
+        std::vector<unsigned int> soup_indices, indices;
+        synthetic_soup(128, soup, soup_indices);
+        run("core::weld_vertices/128x128_grid", [&]{
+            vertices = soup;
+            indices = soup_indices;
+            core::weld_vertices(vertices, indices);
+            do_not_optimize(indices);
+        });
+        std::cerr << "weld: " << soup.size() << " -> " << vertices.size() << " vertices ("
+                  << sizeof(core::VertexGL) * soup.size() / 1024 << " -> " << sizeof(core::VertexGL) * vertices.size() / 1024 << " KB)" << std::endl;
+
+        // welded grid in random triangle order
+        std::vector<unsigned int> shuffled;
+        {
+            std::vector<int> order(indices.size() / 3);
+            for(int t = 0; t < (int)order.size(); ++t)
+                order[t] = t;
+            std::shuffle(order.begin(), order.end(), rng);
+            for(int t : order)
+                shuffled.insert(shuffled.end(), indices.begin() + t * 3, indices.begin() + t * 3 + 3);
+        }
+        std::vector<core::VertexGL> opt_vertices;
+        std::vector<unsigned int> opt_indices;
+        run("core::optimize_mesh/128x128_grid", [&]{
+            opt_vertices = vertices;
+            opt_indices = shuffled;
+            core::optimize_mesh(opt_vertices, opt_indices);
+            do_not_optimize(opt_indices);
+        });
+        auto before = core::analyze_vertex_cache(shuffled, vertices.size());
+        auto after = core::analyze_vertex_cache(opt_indices, opt_vertices.size());
+        std::cerr << "vertex cache: ACMR " << before.acmr << " -> " << after.acmr
+                  << ", ATVR " << before.atvr << " -> " << after.atvr << std::endl;
+
+        auto bounds = core::compute_bounds(opt_vertices);
+        run("core::pack_vertices/128x128_grid", [&]{
+            auto packed = core::pack_vertices(opt_vertices, bounds);
+            do_not_optimize(packed);
+        });
+        std::cerr << "vertex size: " << sizeof(core::VertexGL) << " -> " << sizeof(core::PackedVertexGL) << " bytes" << std::endl;
+    }
+
+    // ik
+    {
+        auto joints = model->joints();
+        auto parent = joints.at(1), child = joints.at(2), end = joints.at(3);
+        Mat4 target = end->world_trf();
+        target.block<3, 1>(0, 3) += Vec3(3.0f, -2.0f, 1.0f);
+        run("two_bone_ik", [&]{
+            two_bone_ik(parent, child, end, target, false);
+        });
+    }
+
+    // keyframe resampling
+    {
+        auto keys = synthetic_curve(120, 10.0f);
+        std::vector<float> timestep;
+        for(float t = 0.0f; t <= 10.0f; t += 1.0f / 30.0f)
+            timestep.push_back(t);
+
+        run("keyframe::resample/120_keys_to_300", [&]{
+            auto resampled = keyframe::resample(keys, timestep);
+            do_not_optimize(resampled);
+        });
+
+        auto node = std::make_shared<NodeKeyFrames>();
+        node->name = "node";
+        node->euler_order = glm::ivec3(0, 1, 2);
+        for(int k = 0; k < 3; ++k)
+        {
+            node->euler[k] = synthetic_curve(120, 10.0f);
+            node->pos[k] = synthetic_curve(120, 10.0f);
+        }
+        run("keyframe::resample/node", [&]{
+            auto resampled = keyframe::resample(node, timestep);
+            do_not_optimize(resampled);
+        });
+
+        std::vector<float> values(timestep.size());
+        run("keyframe::sample/120_keys_to_300", [&]{
+            keyframe::sample(keys, timestep.data(), (int)timestep.size(), values.data());
+            do_not_optimize(values);
+        });
+
+        auto cubic = keys;
+        for(auto& key : cubic)
+        {
+            key.type = KeyInterpType::kCubic;
+            key.left_slope = key.right_slope = 270.0f * std::cos(3.0f * key.time);
+        }
+        run("keyframe::sample/120_cubic_keys_to_300", [&]{
+            keyframe::sample(cubic, timestep.data(), (int)timestep.size(), values.data());
+            do_not_optimize(values);
+        });
+
+        auto scene = std::make_shared<SceneKeyFrames>();
+        scene->name = "scene";
+        scene->start_time = 0.0f;
+        scene->end_time = 10.0f;
+        scene->node_keyframes.assign(64, node);
+        run("keyframe::sample/scene_64_nodes", [&]{
+            auto sampled = keyframe::sample(scene, timestep);
+            do_not_optimize(sampled);
+        });
+    }
+
+    // euler -> quaternion of a long multi-take file: 8 takes x 60 sec x 60 fps, 64 joints
+    {
+        const int take_num = 8, joint_num = 64, frame_num = 60 * 60;
+        std::vector<float> euler((size_t)joint_num * 3 * frame_num);
+        for(auto& e : euler)
+            e = uniform(-180.0f, 180.0f);
+        std::vector<float> qw(frame_num), qx(frame_num), qy(frame_num), qz(frame_num);
+        std::vector<glm::quat> quats(frame_num);
+
+        run("keyframe::euler_to_quat/8_takes_64_joints_60s", [&]{
+            for(int t = 0; t < take_num; ++t)
+            for(int j = 0; j < joint_num; ++j)
+            {
+                const float* e = euler.data() + (size_t)j * 3 * frame_num;
+                keyframe::euler_to_quat(e, e + frame_num, e + 2 * frame_num, glm::ivec3(2, 0, 1), frame_num,
+                                        qw.data(), qx.data(), qy.data(), qz.data());
+            }
+            do_not_optimize(qw);
+        });
+
+        run("keyframe::to_quaternions/8_takes_64_joints_60s", [&]{
+            for(int t = 0; t < take_num; ++t)
+            for(int j = 0; j < joint_num; ++j)
+            {
+                const float* e = euler.data() + (size_t)j * 3 * frame_num;
+                keyframe::to_quaternions(e, e + frame_num, e + 2 * frame_num, glm::ivec3(2, 0, 1), frame_num, quats.data());
+            }
+            do_not_optimize(quats);
+        });
+
+        // sampling + conversion of every take
+        auto take = std::make_shared<SceneKeyFrames>();
+        take->name = "take";
+        take->start_time = 0.0f;
+        take->end_time = 60.0f;
+        std::vector<std::string> names;
+        for(int j = 0; j < joint_num; ++j)
+        {
+            auto node = std::make_shared<NodeKeyFrames>();
+            node->name = "joint" + std::to_string(j);
+            node->euler_order = glm::ivec3(2, 0, 1);
+            for(int k = 0; k < 3; ++k)
+                node->euler[k] = synthetic_curve(600, 60.0f);
+            take->node_keyframes.push_back(node);
+            names.push_back(node->name);
+        }
+        std::vector<MotionClip> clips(take_num, MotionClip(take, names));
+        run("MotionClip::motion/8_takes_64_joints_60s", [&]{
+            for(const auto& clip : clips)
+            {
+                auto motion = clip.motion(60.0f);
+                do_not_optimize(motion);
+            }
+        });
+    }
+
+    // eigen <-> glm
+    {
+        Mat4 m = model->joints().back()->world_trf();
+        glm::mat4 g = to_glm(m);
+        Quat q = random_rot(1.0f);
+        glm::quat gq = to_glm(q);
+
+        run("to_glm/mat4", [&]{ auto r = to_glm(m); do_not_optimize(r); });
+        run("to_eigen/mat4", [&]{ auto r = to_eigen(g); do_not_optimize(r); });
+        run("to_glm/quat", [&]{ auto r = to_glm(q); do_not_optimize(r); });
+        run("to_eigen/quat", [&]{ auto r = to_eigen(gq); do_not_optimize(r); });
+    }
+
+    if(options.output.empty())
+        write_json(std::cout);
+    else
+    {
+        std::ofstream file(options.output);
+        write_json(file);
+        std::cout << "saved " << options.output << std::endl;
+    }
+    return 0;
+}
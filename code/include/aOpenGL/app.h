@@ -6,6 +6,8 @@
 
 #include "camera.h"
 #include "light.h"
+#include "capture.h"
+#include "jobs.h"
 
 namespace a::gl {
 
@@ -21,6 +23,10 @@ public:
    virtual void late_update(){}
    virtual void render(){}
    virtual void render_xray(){}
+
+   // update thread 사용 시 render thread 에서 update 가 멈춘 사이에 call 됨.
+   // update() 가 쓰는 state 를 render() 가 읽는 state 로 복사 (double buffer).
+   virtual void sync(){}
    virtual void key_callback(char key, int action);
    virtual void key_callback(int key, int action);
 
@@ -43,22 +49,69 @@ public:
    // set
    void set_window_size(int width, int height) { m_width = width; m_height = height; }
 
+   // update loop
+   // timestep > 0: update() 를 고정된 간격 (sec) 으로 호출. frame 당 최대 max_steps 번, 밀린 시간은 버림.
+   // timestep = 0: frame 당 한번 (default). headless 에서는 frame 당 정확히 한번.
+   void set_fixed_timestep(float timestep, int max_steps = 5) { m_timestep = timestep; m_max_steps = max_steps; }
+   float timestep() { return m_timestep; }
+   int max_steps() { return m_max_steps; }
+
+   // [0, 1]: (마지막 update 이후 지난 시간) / timestep. render() 에서 이전 state 와 보간할 때 사용.
+   float alpha() { return m_alpha; }
+
+   // update() 를 별도 thread 에서 fixed timestep 으로 실행. sync() 참고. start() 가 끝난 뒤에는 바꿀 수 없음.
+   void set_update_thread(bool set) { m_update_thread = set; }
+   bool update_thread() { return m_update_thread; }
+
+   // update() 다음에 실행되는 parallel stages. e.g. model 별 set_pose, update_mesh
+   // update thread 사용 시에는 render thread 에서 sync() 다음, frame 당 한번 실행 (update thread 는 멈춘 상태).
+   FrameGraph& update_graph() { return m_update_graph; }
+
+   void set_vsync(bool set) { m_vsync = set; }
+   bool vsync() { return m_vsync; }
+
+   // quit the main loop after the current frame
+   void close() { m_closed = true; }
+   bool is_closed() { return m_closed; }
+
    // capture
 
    bool capture() { return m_capture; }
    void capture(bool set) { m_capture = set; }
    void set_capture_path(std::string path) { m_capture_path = path; }
    std::string capture_path() { return m_capture_path; }
+   void set_capture_format(CaptureFormat format) { m_capture_format = format; }
+   CaptureFormat capture_format() { return m_capture_format; }
+
+   // video capture (CaptureFormat::PIPE, Y4M, MJPEG). written to capture_path() + "video_N"
+   // command: raw rgb24 frames go to its stdin. {width} {height} {fps} {output} are replaced, {output} shell-quoted. (empty: AGL_CAPTURE_COMMAND)
+   void set_capture_command(std::string command) { m_capture_command = command; }
+   std::string capture_command() { return m_capture_command; }
+   void set_capture_fps(int fps) { m_capture_fps = fps; }
+   int capture_fps() { return m_capture_fps; }
 
 private:
+   friend class AppManager;
+
    Camera m_camera;
    Light  m_light;
    bool   m_capture;
+   bool   m_closed{false};
+
+   float  m_timestep{0.0f};
+   int    m_max_steps{5};
+   float  m_alpha{0.0f};
+   bool   m_update_thread{false};
+   bool   m_vsync{true};
+   FrameGraph m_update_graph;
    
    int    m_width;
    int    m_height;
 
    std::string m_capture_path;
+   CaptureFormat m_capture_format{CaptureFormat::PNG};
+   std::string m_capture_command;
+   int         m_capture_fps{60};
 
    struct IO;
    std::unique_ptr<App::IO> _io;
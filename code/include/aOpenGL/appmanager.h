@@ -2,6 +2,7 @@
 #pragma GCC system_header
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
+#include "capture.h"
 
 namespace a {
 namespace gl {
@@ -25,7 +26,35 @@ public:
     static void set_app(App* app);
     static void start_loop();
     static void terminate();
+
+    /**
+     * @brief window 없이 offscreen FBO 에 렌더링. (EGL / OSMesa)
+     *        swap, vsync 없이 가능한 빠르게 update/render 반복. 해상도는 app->width(), app->height().
+     * @param frame_num number of frames to render (-1: until App::close())
+     */
+    static void start_headless(App* app, int frame_num = -1)
+    {
+        AppManager::set_app(app);
+        AppManager::start_headless_loop(frame_num);
+    }
+    static void start_headless_loop(int frame_num = -1);
+
+    /**
+     * @brief captured / queued / written / dropped frame counts
+     */
+    static CaptureStats capture_stats();
 private:
+    static void initialize_render();
+    static void render_frame(int width, int height, double frame_time);
+    static void update_frame(double frame_time);
+    static void update_app();
+    static void start_update_thread();
+    static void stop_update_thread();
+    static void update_thread_loop();
+    static void capture_frame();
+    static void finish_capture();
+
+
     static void on_key_down(GLFWwindow* window, int key, int scancode, int action, int mods);   
     static void on_mouse_move(GLFWwindow* window, double xpos, double ypos);
     static void on_mouse_button_click(GLFWwindow* window, int button, int action, int mods);
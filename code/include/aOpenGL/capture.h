@@ -0,0 +1,28 @@
+#pragma once
+#include <cstddef>
+
+namespace a::gl {
+
+/**
+ * @brief file format of the captured frames.
+ *        PNG: encoder thread 에서 압축. RAW: 압축 없이 binary PPM (P6) 으로 저장. 가장 빠름.
+ *        아래는 video stream. frame 을 버리지 않고 순서대로 하나의 stream 에 씀.
+ *        PIPE : raw rgb24 frame 을 child process (e.g. ffmpeg) 의 stdin 으로 보냄. App::set_capture_command()
+ *        Y4M  : uncompressed YUV4MPEG2 (4:4:4) file
+ *        MJPEG: JPEG frame 을 이어 붙인 motion jpeg file
+ */
+enum class CaptureFormat{PNG, RAW, PIPE, Y4M, MJPEG};
+
+/**
+ * @brief frame capture 상태 정보. AppManager::capture_stats()
+ */
+struct CaptureStats
+{
+    size_t captured{0};  // frames read back from the GPU
+    size_t queued{0};    // frames waiting for an encoder
+    size_t written{0};   // frames saved
+    size_t dropped{0};   // frames skipped because the queue was full (or the video size changed)
+    size_t stalls{0};    // video frames that waited for the writer (backpressure)
+};
+
+}
\ No newline at end of file
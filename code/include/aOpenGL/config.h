@@ -27,9 +27,56 @@
 // Shadow map size
 #define AGL_SHADOW_MAP_SIZE        4 * 1024
 
+// Cascaded shadow maps (0: single shadow map around Light::focus)
+#define AGL_MAX_SHADOW_CASCADES    4
+#define AGL_SHADOW_CASCADES        0
+#define AGL_SHADOW_CASCADE_SIZE    2 * 1024
+#define AGL_SHADOW_DISTANCE        50.0f
+#define AGL_SHADOW_CASTER_DISTANCE 20.0f
+
+// Keep the depth of static casters and redraw only dynamic casters every frame
+#define AGL_SHADOW_STATIC_CACHE    1
+
 // Arrow FBX Path
 #define AGL_ARROW_FBX               "/data/fbx/etc/arrow.fbx"
 #define AGL_AXIS_FBX                "/data/fbx/etc/axis.fbx"
 
 #define AGL_FONT_PATH               "/data/fonts/NotoSans-Regular.ttf"
-#define AGL_FONT_RESOLUTION         256
\ No newline at end of file
+#define AGL_FONT_RESOLUTION         256
+#define AGL_FONT_ATLAS_WIDTH        2048
+#define AGL_TEXT_CACHE_SIZE         1024
+
+// Image & texture cache budget in bytes (0: unlimited)
+#define AGL_IMAGE_CACHE_BUDGET      ((size_t)512 * 1024 * 1024)
+#define AGL_TEXTURE_CACHE_BUDGET    ((size_t)1024 * 1024 * 1024)
+
+// Frame capture: PBO ring size, max frames waiting for encoders, encoder threads (0: half of the cores)
+#define AGL_CAPTURE_PBO_NUM         3
+#define AGL_CAPTURE_QUEUE_SIZE      16
+#define AGL_CAPTURE_THREADS         0
+
+// Video capture: default command of CaptureFormat::PIPE and MJPEG quality
+#define AGL_CAPTURE_COMMAND         "ffmpeg -y -loglevel error -f rawvideo -pix_fmt rgb24 -s {width}x{height} -r {fps} -i - -pix_fmt yuv420p {output}.mp4"
+#define AGL_CAPTURE_JPEG_QUALITY    90
+
+// Job system worker threads (0: hardware concurrency - 1)
+#define AGL_JOB_THREADS             0
+
+// Profiler: frames of the rolling average, frames in flight of GPU timer queries, overlay font size (pixels), F4 trace length
+#define AGL_PROFILER_WINDOW         60
+#define AGL_PROFILER_QUERY_FRAMES   2
+#define AGL_PROFILER_FONT_SIZE      16
+#define AGL_PROFILER_TRACE_FRAMES   300
+
+// Program binary cache directory (glProgramBinary). empty string disables the cache
+#define AGL_SHADER_CACHE_DIR        "/cache/shaders"
+
+// Import-time mesh optimization: simulated post-transform cache size, allowed ACMR increase of the overdraw ordering
+#define AGL_VERTEX_CACHE_SIZE       16
+#define AGL_OVERDRAW_THRESHOLD      1.05f
+
+// Upload imported meshes as 32 byte core::PackedVertexGL instead of core::VertexGL
+#define AGL_PACKED_VERTICES         1
+
+// Binary model cache directory of FBX::model() (skips the FBX SDK while the source is unchanged). empty string disables the cache
+#define AGL_MODEL_CACHE_DIR         "/cache/models"
\ No newline at end of file
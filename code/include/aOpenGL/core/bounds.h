@@ -0,0 +1,61 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <vector>
+
+namespace a::gl {
+namespace core {
+
+struct VertexGL;
+
+/**
+ * @brief Bounding volume (AABB + sphere).
+ *        radius < 0 이면 bounds 정보가 없는 것. 항상 visible 로 취급.
+ */
+struct Bounds
+{
+    glm::vec3 min{0, 0, 0};
+    glm::vec3 max{0, 0, 0};
+    glm::vec3 center{0, 0, 0};
+    float     radius{-1.0f};
+
+    bool valid() const { return radius >= 0.0f; }
+
+    /**
+     * @brief extend the box by the point. sphere 는 finalize()에서 계산.
+     */
+    void expand(const glm::vec3& p);
+    void finalize();
+};
+
+/**
+ * @return bounds of the vertex positions
+ */
+Bounds compute_bounds(const std::vector<VertexGL>& vertices);
+
+/**
+ * @brief 6 planes extracted from view-projection matrix. (Gribb & Hartmann)
+ *        plane: dot(n, x) + d >= 0 이면 안쪽.
+ */
+struct Frustum
+{
+    glm::vec4 planes[6];
+
+    Frustum() = default;
+    explicit Frustum(const glm::mat4& view_projection);
+
+    bool intersects_sphere(const glm::vec3& center, float radius) const;
+
+    /**
+     * @brief oriented box test.
+     * @param model object to world transform of the bounds
+     */
+    bool intersects(const Bounds& bounds, const glm::mat4& model) const;
+
+    /**
+     * @brief bounds already in world space
+     */
+    bool intersects(const Bounds& bounds) const;
+};
+
+}
+}
@@ -1,9 +1,11 @@
 #pragma once
 #include <glm/glm.hpp>
+#include <cstdint>
 #include <vector>
 #include <map>
 #include <memory>
 #include <glad/glad.h>
+#include "bounds.h"
 
 namespace a::gl {
 namespace core {
@@ -15,6 +17,12 @@ struct VAO
 {
     GLuint vao, vbo, ebo;
     int idx_num;
+    Bounds bounds;  // object space
+
+    // PackedVertexGL layout. position = position_offset + position_scale * unorm16 position
+    bool      packed{false};
+    glm::vec3 position_offset{0, 0, 0};
+    glm::vec3 position_scale{1, 1, 1};
 };
 
 /**
@@ -32,6 +40,32 @@ struct VertexGL
     glm::vec4 skinning_weights;
 };
 
+/**
+ * @brief 32 byte vertex for the gpu. same attribute locations as VertexGL.
+ *        bitangent 은 저장하지 않고 shader 에서 cross(normal, tangent) * sign 으로 계산.
+ */
+struct PackedVertexGL
+{
+    uint32_t position[2];         // unorm16 x 4 in the mesh bounds. w: bitangent sign (0: -1, 1: +1)
+    uint32_t normal;              // octahedral, snorm16 x 2
+    uint32_t tangent;             // octahedral, snorm16 x 2
+    uint32_t uv;                  // half x 2
+    uint8_t  skinning_idxes[4];
+    uint8_t  skinning_weights[4]; // unorm8, sum is 255
+    uint8_t  material_id;
+    uint8_t  padding[3];
+};
+static_assert(sizeof(PackedVertexGL) == 32, "PackedVertexGL must be 32 bytes");
+
+/**
+ * @brief per instance attributes for instanced drawing
+ */
+struct InstanceGL
+{
+    glm::mat4 model;
+    glm::vec4 color;
+};
+
 /**
  * @brief MeshGL
  */
@@ -51,6 +85,12 @@ struct MeshGL
     std::vector<std::string>   joint_order;
     std::map<std::string, int> name_to_idx;
     std::vector<glm::mat4>     jonit_bind_trf_inv;
+
+    /**
+     * @brief max distance between a vertex and any joint with a nonzero weight on it, in the bind pose.
+     *        skinned mesh 의 bounds 는 joint 위치들의 box 를 이 값만큼 키워서 사용.
+     */
+    float                      skin_radius{0.0f};
     
     //std::vector<Material>      materials;
 };
@@ -61,6 +101,34 @@ using spMeshGL = std::shared_ptr<MeshGL>;
  */
 VAO bind_mesh(std::vector<VertexGL>& varray, std::vector<unsigned int>& indices);
 
+/**
+ * @brief bind_mesh() with PackedVertexGL. VAO::packed 와 dequantization 값이 설정됨.
+ *        joint 또는 material index 가 255 를 넘으면 VertexGL 로 bind.
+ */
+VAO bind_packed_mesh(std::vector<VertexGL>& varray, std::vector<unsigned int>& indices);
+
+/**
+ * @param bounds position 의 quantization 범위 (compute_bounds)
+ */
+std::vector<PackedVertexGL> pack_vertices(const std::vector<VertexGL>& varray, const Bounds& bounds);
+
+/**
+ * @brief mesh 의 vbo, ebo 를 공유하고 instance_vbo 의 InstanceGL 을 attribute 8 ~ 12 로 사용하는 VAO
+ */
+VAO bind_instanced(const VAO& mesh, GLuint instance_vbo);
+
+/**
+ * @return MeshGL::skin_radius
+ */
+float compute_skin_radius(const std::vector<VertexGL>& varray, const std::vector<glm::mat4>& bind_trf_inv);
+
+/**
+ * @brief merge bitwise identical vertices (position, normal, uv, tangent, material, skinning) and remap the indices.
+ *        fbx import 는 triangle 마다 vertex 3개를 만들기 때문에 shared vertex 로 줄여야 post-transform cache 가 동작.
+ * @return number of vertices after welding
+ */
+size_t weld_vertices(std::vector<VertexGL>& varray, std::vector<unsigned int>& indices);
+
 /**
  * @brief tangent와 bitangent를 uv를 활용하여 계산. 만약 uv가 discontinuous 하다면 사용하지 말것.
  *        이 함수는 사용 x.
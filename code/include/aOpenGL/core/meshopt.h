@@ -0,0 +1,44 @@
+#pragma once
+#include <vector>
+#include <cstddef>
+
+namespace a::gl {
+namespace core {
+
+struct VertexGL;
+
+/**
+ * @brief post-transform cache efficiency of an index buffer (FIFO cache simulation)
+ */
+struct VertexCacheStats
+{
+    size_t transformed{0};  // vertex shader invocations
+    float  acmr{0.0f};      // average cache miss ratio: transformed / triangles (0.5 ~ 3)
+    float  atvr{0.0f};      // average transform to vertex ratio: transformed / used vertices (1 is optimal)
+};
+
+VertexCacheStats analyze_vertex_cache(const std::vector<unsigned int>& indices, size_t vertex_num, int cache_size = 16);
+
+/**
+ * @brief triangle order for the post-transform cache. Tipsify (Sander et al. 2007): fan around the vertex that stays in the cache.
+ */
+void optimize_vertex_cache(std::vector<unsigned int>& indices, size_t vertex_num, int cache_size = 16);
+
+/**
+ * @brief split the cache-optimized triangles into clusters and draw the outward facing clusters first.
+ *        optimize_vertex_cache() 이후에 call. cluster 의 ACMR 이 threshold 배 이상 나빠지지 않는 곳에서만 자름.
+ */
+void optimize_overdraw(std::vector<unsigned int>& indices, const std::vector<VertexGL>& vertices, float threshold = 1.05f, int cache_size = 16);
+
+/**
+ * @brief vertex 순서를 index buffer 에서 처음 사용되는 순서로 바꿈. 사용되지 않는 vertex 는 제거.
+ */
+void optimize_vertex_fetch(std::vector<VertexGL>& vertices, std::vector<unsigned int>& indices);
+
+/**
+ * @brief vertex cache -> overdraw -> vertex fetch
+ */
+void optimize_mesh(std::vector<VertexGL>& vertices, std::vector<unsigned int>& indices, float threshold = 1.05f, int cache_size = 16);
+
+}
+}
\ No newline at end of file
@@ -25,9 +25,24 @@ public:
 
     /**
      * @brief build shader program. this->program 에 handle 저장
+     *        cache dir 이 설정되어 있으면 glProgramBinary 로 저장된 program 을 먼저 load 하고,
+     *        driver 가 binary 를 거부하면 source 에서 compile 후 다시 저장.
      */
     Shader build();
 
+    /**
+     * @brief program binary cache directory. empty string disables the cache.
+     *        key: hash of the sources + GL vendor / renderer / version
+     */
+    static void set_cache_dir(const std::string& dir) { s_cache_dir = dir; }
+    static const std::string& cache_dir() { return s_cache_dir; }
+
+    /**
+     * @return number of programs loaded from / saved to the binary cache since start
+     */
+    static int cache_hits() { return s_cache_hits; }
+    static int cache_misses() { return s_cache_misses; }
+
     /**
      * @brief activate the shader
      */
@@ -67,8 +82,18 @@ public:
     void setMultipleIvec4(std::string name, int numberOfVectors,  const glm::ivec4* vectors) const;
 
 private:
+    bool load_binary(const std::string& path);
+    void save_binary(const std::string& path) const;
+    std::string cache_path() const;
+
     GLuint m_program, m_vertexShader, m_fragmentShader, m_geometryShader;
     bool m_view_updated, m_texture_updated;
+
+    // sources are kept until build() so that a cached binary can skip the compile
+    std::string m_vertexCode, m_fragmentCode, m_geometryCode;
+
+    static std::string s_cache_dir;
+    static int         s_cache_hits, s_cache_misses;
 };
 
 }}
\ No newline at end of file
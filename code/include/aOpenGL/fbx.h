@@ -1,6 +1,8 @@
 #pragma once
 #include "motion.h"
+#include "motionclip.h"
 #include "material.h"
+#include <functional>
 #include <memory>
 #include <string>
 
@@ -18,6 +20,19 @@ using spModel = std::shared_ptr<Model>;
 using spMesh  = std::shared_ptr<Mesh>;
 using spJoint = std::shared_ptr<Joint>;
 
+/**
+ * @brief result of FBX::import_motions for one file
+ */
+struct MotionImport
+{
+    std::string         path;
+    std::vector<Motion> motions;
+    std::string         error;  // empty if succeeded
+    double              ms{0.0};
+
+    bool ok() const { return error.empty(); }
+};
+
 /**
  * @brief import fbx
  */
@@ -44,12 +59,55 @@ public:
      */
     spModel model();
 
-    std::vector<Motion> motion(spModel model);    
+    /**
+     * @param fps sampling rate (e.g. 30, 60, 120). <= 0: rate of the source file
+     */
+    std::vector<Motion> motion(spModel model, float fps = 60.0f);
     
     /**
      * @brief motion 정보는 jnts의 name 순서대로 가져옴.
+     * @param fps sampling rate (e.g. 30, 60, 120). <= 0: rate of the source file
+     */
+    std::vector<Motion> motion(const std::vector<spJoint>& jnts, float fps = 60.0f);
+
+    /**
+     * @brief parsed curves of every scene, sampled on demand (MotionClip::pose, MotionClip::motion).
+     *        joint 순서는 jnts 의 name 순서.
+     */
+    std::vector<MotionClip> clips(const std::vector<spJoint>& jnts);
+    std::vector<MotionClip> clips(spModel model);
+
+    /**
+     * @param done number of finished files including this one
+     */
+    using ImportProgress = std::function<void(const MotionImport& file, int done, int total)>;
+
+    /**
+     * @brief import the motions of many files in parallel. results are in the order of paths.
+     *        worker 마다 FbxManager 하나를 사용하고, 파일마다 scene 을 따로 import 후 삭제.
+     *        한 파일의 실패는 그 파일의 MotionImport::error 에만 기록.
+     *        각 파일의 resampling 은 그 worker 에서 serial 로 실행 (JobSystem 사용 안 함).
+     * @param progress called from the workers, one at a time. progress 가 throw 하면 import 를 멈추고
+     *                 worker 들이 끝난 뒤 그 exception 을 다시 throw.
+     * @param threads number of workers (0: hardware concurrency)
+     * @param fps sampling rate. <= 0: rate of each source file
+     */
+    static std::vector<MotionImport> import_motions(const std::vector<std::string>& paths,
+                                                    const std::vector<spJoint>& jnts,
+                                                    float scale = 0.01,
+                                                    ImportProgress progress = nullptr,
+                                                    int threads = 0,
+                                                    float fps = 60.0f);
+
+    /**
+     * @brief motions of the files imported successfully, in the order of paths.
+     *        e.g. kinmotion(kmodel, FBX::motions(paths, model))
      */
-    std::vector<Motion> motion(const std::vector<spJoint>& jnts);
+    static std::vector<Motion> motions(const std::vector<std::string>& paths, 
+                                       spModel model, 
+                                       float scale = 0.01,
+                                       ImportProgress progress = nullptr,
+                                       float fps = 60.0f);
 
 private:
     /**
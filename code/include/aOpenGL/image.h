@@ -1,12 +1,28 @@
 #pragma once
 #include <string>
 #include <map>
+#include <list>
 #include <memory>
 
 namespace a::gl {
 
+/**
+ * @brief cache 상태 정보. Image 와 TextureLoader 에서 사용.
+ */
+struct CacheStats
+{
+    size_t hits{0};
+    size_t misses{0};
+    size_t evictions{0};
+    size_t entries{0};
+    size_t bytes_resident{0};
+    size_t bytes_budget{0};   // 0 if unlimited
+};
+
 /**
  * @brief 이미지 데이터 관리 class. 한번 읽은 데이터는 m_images 멤버 변수에 저장해둠.
+ *        m_images 는 byte budget 을 넘으면 오래 사용하지 않은 image 부터 지움 (LRU).
+ *        밖에서 spData 를 들고 있는 image 는 지우지 않음.
  * @author ckm
  * @since Wed Aug 12 2020
  */
@@ -56,8 +72,36 @@ public:
         instance()->_free_image(path);
     }
 
+    /**
+     * @brief cache 외에 image 를 참조하는 곳이 없을 경우에만 pixel data 를 해제.
+     * @return true if released
+     */
+    static bool release(std::string path)
+    {
+        return instance()->_release(path);
+    }
+
+    /**
+     * @brief decoded pixel 의 최대 byte 수. 0 일 경우 제한 없음.
+     */
+    static void set_budget(size_t bytes)
+    {
+        instance()->_set_budget(bytes);
+    }
+
+    static CacheStats stats()
+    {
+        return instance()->m_stats;
+    }
+
+    /**
+     * @brief png 저장. global stb flip flag 를 쓰지 않으므로 여러 thread 에서 동시에 call 가능.
+     */
     static void save_image(std::string save_name, spData data, bool flip = false);
-    static void save_image(std::string save_name, const char* data, int width, int height, int channel, bool flip = false);
+    /**
+     * @param stride bytes between rows (0: width * channel). 음수면 data 는 마지막 row 를 가리킴.
+     */
+    static void save_image(std::string save_name, const char* data, int width, int height, int channel, bool flip = false, int stride = 0);
 
 private:
     static Image* instance()
@@ -71,9 +115,24 @@ private:
     Image::spData _create(std::string path, unsigned char* img, int width, int height, int channel); // create empty image
     Image::spDataHDR _load_hdr(std::string path);
     void _free_image(std::string path);
-    
-    std::map<std::string, Image::spData> m_images;
+    bool _release(std::string path);
+    void _set_budget(size_t bytes);
+    void _insert(const std::string& path, Image::spData data);
+    void _evict();
+
+    struct Entry
+    {
+        Image::spData data;
+        size_t bytes;
+        std::list<std::string>::iterator lru; // position in m_lru
+    };
+
+    std::map<std::string, Entry> m_images;
     std::map<std::string, Image::spDataHDR> m_hdrs;
+
+    // front: most recently used
+    std::list<std::string> m_lru;
+    CacheStats m_stats;
 };
 
 }
\ No newline at end of file
@@ -0,0 +1,111 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <deque>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+namespace a::gl {
+
+/**
+ * @brief worker thread pool. 한번 생성된 thread 는 프로그램이 끝날 때까지 재사용.
+ *        thread 수는 AGL_JOB_THREADS (0: hardware concurrency - 1).
+ */
+class JobSystem
+{
+public:
+    /**
+     * @brief call func(i) for i in [0, count) in parallel and wait.
+     *        caller thread 도 job 을 처리하므로 job 안에서 다시 call 해도 됨.
+     *        func 가 throw 하면 모든 job 이 끝난 뒤 첫 exception 을 caller 에서 다시 throw.
+     * @param grain number of items per job (0: auto)
+     */
+    static void parallel_for(int count, const std::function<void(int)>& func, int grain = 0)
+    {
+        instance()->_parallel_for(count, func, grain);
+    }
+
+    /**
+     * @return number of worker threads (caller thread 제외)
+     */
+    static int thread_num()
+    {
+        return (int)instance()->m_threads.size();
+    }
+
+private:
+    static JobSystem* instance()
+    {
+        static JobSystem* jobs = new JobSystem;
+        return jobs;
+    }
+
+    JobSystem();
+    void _parallel_for(int count, const std::function<void(int)>& func, int grain);
+    bool _run_one(); // run a queued job on the calling thread
+    void _worker();
+
+    std::vector<std::thread>           m_threads;
+    std::deque<std::function<void()>>  m_jobs;
+    std::mutex                         m_mutex;
+    std::condition_variable            m_cv;
+};
+
+/**
+ * @brief update stage 들의 dependency graph. AppManager 가 App::update() 직후, render 전에 실행.
+ *        stage 는 dependency 순서대로 하나씩 실행되고, 각 stage 의 item 들은 JobSystem 에서 병렬로 처리.
+ *        e.g. "pose" (set_pose) -> "skin" (update_mesh)
+ */
+class FrameGraph
+{
+public:
+    using Job = std::function<void(int)>;
+
+    struct Timing
+    {
+        std::string name;
+        double      ms;
+    };
+
+    /**
+     * @param count   number of items (e.g. models). job(i) is called once per item.
+     * @param depends stages that must finish before this one
+     */
+    void add(const std::string& name, int count, Job job, const std::vector<std::string>& depends = {});
+
+    /**
+     * @brief change the number of items of the stage
+     */
+    void resize(const std::string& name, int count);
+    void clear();
+    bool empty() const { return m_stages.empty(); }
+
+    /**
+     * @brief run all the stages. throws std::runtime_error for an unknown dependency or a cycle.
+     */
+    void run();
+
+    /**
+     * @brief wall time of each stage in the last run(), in execution order
+     */
+    const std::vector<Timing>& timings() const { return m_timings; }
+
+private:
+    struct Stage
+    {
+        std::string              name;
+        int                      count;
+        Job                      job;
+        std::vector<std::string> depends;
+    };
+
+    void sort();
+
+    std::vector<Stage>  m_stages;
+    std::vector<int>    m_order;    // topological order. empty if not sorted yet
+    std::vector<Timing> m_timings;
+};
+
+}
\ No newline at end of file
@@ -0,0 +1,92 @@
+#pragma once
+#include "kinmotion.h"
+#include <cstdint>
+
+namespace a::gl {
+
+/**
+ * @brief error budget of kincompressed()
+ */
+struct KinCompressOption
+{
+    float max_position_error{0.005f};   // world joint position (FK), model unit. FBX scale 0.01 -> m
+    float max_angle_error{0.02f};       // local joint rotation, radians
+};
+
+/**
+ * @brief   lossy, error bounded motion storage. KinMotion 과 같은 pidx 로 random access.
+ *          rotation: smallest-three 48 bit quaternion. root position: motion 의 범위에서 16 bit per axis.
+ *          key reduction: joint 마다 필요한 key 만 남기고 사이 frame 은 보간 (nlerp, lerp).
+ *          모든 frame 의 world joint position 오차가 max_position_error 이하가 되도록 tolerance 를 조절.
+ */
+struct KinCompressedMotion : public std::enable_shared_from_this<KinCompressedMotion>
+{
+    /**
+     * @brief keys of one channel: frames[offset, offset + key_num) and their values
+     */
+    struct Track
+    {
+        uint32_t offset;
+        uint32_t key_num;
+    };
+
+    spKinModel                 kmodel;            // pointer
+
+    // motion 관련 정보 (KinMotion 과 같음)
+    std::vector<int>           start_pidxes;      // 각 motion들의 시작 pidx
+    int                        motion_n{0};       // number of motions
+    int                        pose_n{0};         // number of poses
+    std::vector<std::string>   motion_names;
+    std::vector<float>         fbx_start_times;
+    std::vector<float>         fbx_end_times;
+    std::vector<float>         fps;
+    std::vector<float>         position_errors;   // 각 motion의 최대 world position 오차 (measured). budget 이 quantization 오차보다 작으면 넘을 수 있음
+
+    // compressed data
+    std::vector<Track>         rot_tracks;        // [mid * noj + jidx]
+    std::vector<uint16_t>      rot_frames;        // frame index in the motion
+    std::vector<uint16_t>      rot_keys;          // 3 per key. smallest-three
+    std::vector<Track>         pos_tracks;        // [mid], root position
+    std::vector<uint16_t>      pos_frames;
+    std::vector<uint16_t>      pos_keys;          // 3 per key. min + u * step
+    std::vector<Vec3>          pos_mins;          // [mid]
+    std::vector<Vec3>          pos_steps;         // [mid]
+
+    /**
+     * @brief decompress a single pose. no allocation if local_rots has noj elements.
+     * @param local_rots local joint rotations in kmodel joint order
+     */
+    void decompress(int pidx, Vec3& root_position, std::vector<Quat>& local_rots) const;
+
+    /**
+     * @brief decompressed pose as KinMotion would store it
+     */
+    KinPose kinpose(int pidx) const;
+
+    /**
+     * @brief decompressed motion. Pose::local_rotations in the model joint order like FBX::motion,
+     *        so that kinmotion() can read it. kmodel 에 없는 joint 는 identity.
+     */
+    Motion motion(int mid) const;
+
+    int    motion_id(int pidx) const;
+    int    get_pidx(const std::string& take_name, int fbx_frame, int fbx_fps) const;
+    int    get_pidx(int mid, float time) const;
+
+    /**
+     * @return memory of the compressed data and of the same poses as Quat + Vec3
+     */
+    size_t byte_size() const;
+    size_t raw_byte_size() const;
+};
+using spKinCompressedMotion = std::shared_ptr<KinCompressedMotion>;
+
+/**
+ * @brief Constructor. motion 당 최대 65536 frames.
+ *        throws std::runtime_error for a longer motion.
+ */
+spKinCompressedMotion kincompressed(const spKinModel& kmodel,
+                                    const std::vector<Motion>& motions,
+                                    const KinCompressOption& option = KinCompressOption());
+
+}
\ No newline at end of file
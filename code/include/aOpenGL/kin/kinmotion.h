@@ -24,6 +24,7 @@ struct KinMotion : public std::enable_shared_from_this<KinMotion>
     std::vector<std::string>   motion_names;      // 각 motion들의 name
     std::vector<float>         fbx_start_times;   // 각 motion들의 fbx에서 시작
     std::vector<float>         fbx_end_times;     // 각 motion들의 fbx에서 시작
+    std::vector<float>         fps;               // 각 motion들의 sampling rate
 
     // functions
     bool is_same_motion(int pidx0, int pidx1);
@@ -40,6 +41,12 @@ using spKinMotion = std::shared_ptr<KinMotion>;
 spKinMotion kinmotion(const spKinModel& kmodel, const std::vector<Motion>& motions);
 spKinMotion kinmotion(const spKinModel& kmodel, const std::vector<std::vector<Motion>>& motions_vec);
 
+/**
+ * @brief KinPose of a pose as kinmotion() computes it
+ * @param local_rots local joint rotations in kmodel joint order
+ */
+KinPose kinpose(const spKinModel& kmodel, const Vec3& root_position, const std::vector<Mat4>& local_rots);
+
 namespace kin {
 
 // check if pidx0 and pidx1 is same motion
@@ -63,6 +63,12 @@ public:
     int  vertex_num() const;
     bool use_skinning() const;
 
+    /**
+     * @brief skinned mesh: world space bounds updated in update_mesh().
+     *        otherwise: object space bounds of the vertices.
+     */
+    const a::gl::core::Bounds& bounds() const;
+
 private:
     friend class Render;
     
@@ -96,6 +102,11 @@ private:
      * @brief 각 m_joints 에 해당하는 buffer index
      */
     std::vector<int>            m_jnt_buffer_idx;
+
+    /**
+     * @brief world bounds of the skinned mesh. joint 위치들의 box + skin_radius
+     */
+    a::gl::core::Bounds         m_skinned_bounds;
 };
 
 }
\ No newline at end of file
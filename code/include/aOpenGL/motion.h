@@ -26,6 +26,7 @@ struct Motion
     std::vector<Pose> poses;
     float start_time;
     float end_time;
+    float fps{60.0f}; // sampling rate of poses
 };
 
 }
\ No newline at end of file
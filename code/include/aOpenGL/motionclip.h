@@ -0,0 +1,60 @@
+#pragma once
+#include "motion.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace a::gl {
+
+struct SceneKeyFrames;
+
+/**
+ * @brief parsed animation curves of one scene, bound to a joint order (FBX::clips).
+ *        pose 는 필요할 때 원하는 시간에 sampling. FBX scene 은 필요 없으므로 FBX 가 삭제되어도 사용 가능.
+ */
+class MotionClip
+{
+public:
+    /**
+     * @param joint_names pose 의 joint 순서. 첫 joint 가 root (root_position)
+     */
+    MotionClip(std::shared_ptr<const SceneKeyFrames> scene, const std::vector<std::string>& joint_names);
+
+    const std::string& name() const;
+    float start_time() const;   // sec
+    float end_time() const;     // sec
+    float duration() const { return end_time() - start_time(); }
+
+    /**
+     * @return frame rate of the source file (frames per sec)
+     */
+    float source_fps() const;
+    int   joint_num() const { return (int)m_node_idxes.size(); }
+
+    /**
+     * @brief sample a pose at time (sec). 범위 밖의 시간은 첫/마지막 key 로 clamp.
+     */
+    Pose pose(float time) const;
+
+    /**
+     * @brief sample poses at times (sec). joints are sampled in parallel (JobSystem).
+     *        시간 순서로 주면 key search 가 cursor 로 진행되어 빠름.
+     * @param parallel false: calling thread 에서만 sampling (e.g. 이미 여러 thread 에서 clip 들을 처리할 때)
+     */
+    std::vector<Pose> poses(const std::vector<float>& times, bool parallel = true) const;
+
+    /**
+     * @brief resample the clip from start_time to end_time
+     * @param fps frames per sec. <= 0: source_fps()
+     */
+    Motion motion(float fps = 60.0f, bool parallel = true) const;
+
+private:
+    void sample_joint(int j, const std::vector<float>& times, std::vector<Pose>& poses) const;
+    void sample_root(const std::vector<float>& times, std::vector<Pose>& poses) const;
+
+    std::shared_ptr<const SceneKeyFrames> m_scene;
+    std::vector<int> m_node_idxes;  // node index of each joint, -1 if not in the scene
+};
+
+}
\ No newline at end of file
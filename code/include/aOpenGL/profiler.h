@@ -0,0 +1,97 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <cstddef>
+
+namespace a::gl {
+
+/**
+ * @brief frame profiler. CPU scope (RAII), GPU timer query (GL_TIME_ELAPSED), draw counters.
+ *        결과는 화면 overlay (F3) 또는 Chrome trace JSON (chrome://tracing, ui.perfetto.dev).
+ *        main (render) thread 에서만 기록. 다른 thread 의 scope 는 무시함.
+ */
+class Profiler
+{
+public:
+    struct Counters
+    {
+        size_t draw_calls{0};
+        size_t uniform_uploads{0};
+        size_t texture_binds{0};
+        size_t triangles{0};
+    };
+
+    /**
+     * @brief rolling average over the last AGL_PROFILER_WINDOW frames
+     */
+    struct Stat
+    {
+        const char* name;
+        double cpu_ms;  // per frame (sum of all the calls)
+        double gpu_ms;  // < 0 if not measured
+        double calls;   // per frame
+    };
+
+    /**
+     * @brief RAII scope. name 은 string literal 이어야 함 (pointer 를 저장).
+     *        gpu: GL_TIME_ELAPSED query 도 사용. GL query 는 nesting 이 안되므로 안쪽 gpu scope 는 CPU 만 기록.
+     */
+    class Scope
+    {
+    public:
+        explicit Scope(const char* name, bool gpu = false);
+        ~Scope();
+    private:
+        int  m_event{-1};
+        bool m_gpu{false};
+    };
+
+    static void set_enabled(bool set);
+    static bool enabled() { return s_enabled; }
+    static void set_overlay(bool set) { s_overlay = set; }
+    static bool overlay() { return s_overlay; }
+
+    // counters of the current frame
+    static void count_draw(size_t triangles, size_t instances = 1) { s_counters.draw_calls++; s_counters.triangles += triangles * instances; }
+    static void count_uniform() { s_counters.uniform_uploads++; }
+    static void count_texture() { s_counters.texture_binds++; }
+
+    /**
+     * @brief counters of the last finished frame
+     */
+    static Counters counters() { return s_last_counters; }
+    static double frame_ms();
+    static std::vector<Stat> stats();
+
+    /**
+     * @brief record the next frame_num frames for save_trace()
+     * @param path if not empty, saved there when the recording is done
+     */
+    static void start_trace(int frame_num, const std::string& path = "");
+    static bool tracing();
+
+    /**
+     * @brief write the recorded frames as Chrome trace event JSON
+     * @return false if the file can't be written
+     */
+    static bool save_trace(const std::string& path);
+
+private:
+    friend class AppManager;
+
+    static void begin_frame();
+    static void end_frame();
+    static void draw_overlay(int width, int height);
+
+    static bool     s_enabled;
+    static bool     s_overlay;
+    static Counters s_counters;
+    static Counters s_last_counters;
+};
+
+}
+
+#define AGL_PROFILE_CONCAT_(a, b) a##b
+#define AGL_PROFILE_CONCAT(a, b)  AGL_PROFILE_CONCAT_(a, b)
+#define AGL_PROFILE_SCOPE(name)     ::a::gl::Profiler::Scope AGL_PROFILE_CONCAT(agl_profile_scope_, __LINE__)(name)
+#define AGL_PROFILE_GPU_SCOPE(name) ::a::gl::Profiler::Scope AGL_PROFILE_CONCAT(agl_profile_scope_, __LINE__)(name, true)
\ No newline at end of file
@@ -27,6 +27,16 @@ class Render
 {
 public:
     enum class RenderMode{SHADOW, PBR};
+    enum class Primitive{CUBE, SPHERE, PLANE, CYLINDER, CONE, PYRAMID, ARROW};
+
+    /**
+     * @brief per pass counts of the last frame
+     */
+    struct CullStats
+    {
+        int submitted{0};
+        int culled{0};
+    };
 
     static spRenderOptions    cube();
     static spRenderOptions    sphere();
@@ -45,9 +55,39 @@ public:
     static spRenderOptionsVec model(spModel m, bool update_mesh = true);
     static spRenderOptionsVec skeleton(spModel);
 
+    /**
+     * @brief immediate-mode primitive. render() 안에서 call 하면 모아뒀다가 
+     *        pass 마다 primitive 종류별로 instanced draw 한번에 그림. (debug geometry 용)
+     */
+    static void batch(Primitive type, const Vec3& position, float scale, const Vec3& color, bool debug = false);
+    static void batch(Primitive type, const Mat4& transform, const Vec3& scale, const Vec3& color, bool debug = false);
+    static void batch_skeleton(spModel model, const Vec3& color);
+
     static void set_sky_color(float r, float g, float b);
     static void set_sky_color(Vec3 rgb);
 
+    /**
+     * @brief frustum culling on/off. shadow pass 는 light frustum, 나머지는 camera frustum 사용.
+     */
+    static void set_frustum_culling(bool use_cull);
+    static CullStats cull_stats(RenderMode mode);
+
+    /**
+     * @brief cascaded shadow maps. num 이 0 이면 Light::focus 주변의 single shadow map 사용.
+     * @param num        number of cascades (<= AGL_MAX_SHADOW_CASCADES)
+     * @param resolution width & height of each cascade
+     * @param distance   camera 로부터 shadow 를 그리는 최대 거리
+     */
+    static void set_shadow_cascades(int num);
+    static void set_shadow_cascades(int num, int resolution, float distance);
+
+    /**
+     * @brief static caster 들의 depth 를 저장해두고, 매 frame 마다 dynamic caster 만 그림.
+     *        static caster 가 움직이거나 light 가 바뀌면 자동으로 다시 그림.
+     *        움직인 caster 는 dynamic 으로 그리고, 계속 miss 가 나면 (e.g. camera 를 따라가는 cascade) 잠시 cache 를 쓰지 않음.
+     */
+    static void set_shadow_cache(bool use_cache);
+
 private:
     /**
      * App manager에서 Render 관리. private 함수들 call.
@@ -66,6 +106,23 @@ private:
      */
     static void set_render_mode(Render::RenderMode type, int width, int height);
 
+    /**
+     * @return number of shadow passes in a frame (cascade 수 또는 1)
+     */
+    static int shadow_pass_num();
+
+    /**
+     * @brief shadow pass 마다 call. depth target 과 light space matrix, frustum 설정.
+     * @return resolution of the depth target
+     */
+    static int set_shadow_pass(int idx);
+
+    /**
+     * @brief shadow pass 안에서 app->render() 를 call 해야 하는 동안 true.
+     *        static cache 를 사용하면 static / dynamic caster 를 나눠서 그림.
+     */
+    static bool next_shadow_stage(int idx);
+
     /**
      * @brief get background color
      */
@@ -77,6 +134,35 @@ private:
      */
     static void update_render_view(App* app, int width, int height);
 
+    /**
+     * @brief test the option against the frustum of the current pass.
+     * @param record count in cull_stats
+     */
+    static bool is_culled(RenderOptions* option, bool record);
+
+    /**
+     * @brief static caster 가 지난 frame 이후 움직였는지 기록. 움직인 caster 는 dynamic 으로 그림.
+     * @return true if the option is drawn with the static casters
+     */
+    static bool track_static_caster(RenderOptions* option);
+
+    /**
+     * @brief transparent 객체는 바로 그리지 않고 모아뒀다가 
+     *        draw_transparent() 에서 view depth 기준 back-to-front 로 그림.
+     */
+    static void defer_transparent(spRenderOptions option);
+    static void draw_transparent();
+
+    /**
+     * @brief add an instance to the batch of the current pass
+     */
+    static void batch(Primitive type, const glm::mat4& model, const glm::vec3& color, bool debug);
+
+    /**
+     * @brief draw & clear the instances collected by batch(). app->render() 다음에 call.
+     */
+    static void draw_batch();
+
     /**
      * @brief pbr rendering function
      */
@@ -101,13 +187,15 @@ public:
     static core::Shader* lbs_shader;
     static core::Shader* shadow_shader;
     static core::Shader* text_shader;
-    
-    static core::Shader* alpha_primitive_shader;
-    static core::Shader* alpha_lbs_shader;
+
+    // render target of the PBR pass (0: window, headless: offscreen FBO)
+    static unsigned int main_fbo;
 
     // shadows
     static unsigned int depth_map_fbo;
     static unsigned int depth_map_handle;
+    static unsigned int cascade_map_fbo;
+    static unsigned int cascade_map_handle;
 
     // environment
     static core::Shader* tocube_shader;
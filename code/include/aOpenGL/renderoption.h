@@ -23,7 +23,6 @@ class RenderOptions : public std::enable_shared_from_this<RenderOptions>
 public:
     RenderOptions(core::VAO vao, 
                   core::Shader* shader, 
-                  core::Shader* alpha_shader, 
                   void (*fpDraw)(spRenderOptions, core::Shader*));
    
     void draw();
@@ -49,10 +48,16 @@ public:
     spRenderOptions disp_scale(float scale = 0.01f);
     spRenderOptions floor_grid(bool use_grid, float line_width = 1.0f, float line_interval = 1.0f, Vec3 line_color = Vec3(0.0f, 0.0f, 0.0f));
     spRenderOptions debug(bool);
+    spRenderOptions frustum_cull(bool);
+    spRenderOptions static_caster(bool);
 
 private:
-    bool is_transparent();
-    void alpha_draw();
+    bool is_transparent() const { return m_transparent; }
+
+    /**
+     * @brief material 의 alpha 가 바뀔때마다 call
+     */
+    void update_transparent();
 
 private:   
     friend class Render;
@@ -61,7 +66,6 @@ private:
     // basic rendering information
     core::VAO              m_vao;
     core::Shader*          m_shader;
-    core::Shader*          m_alpha_shader;
 
     // transformation
     glm::vec3              m_position;
@@ -72,6 +76,7 @@ private:
     std::vector<Material>  m_materials;
     float                  m_disp_map_scale;
     float                  m_uv_repeat;
+    bool                   m_transparent;
 
     // floor grid
     bool                   m_draw_floor_grid;
@@ -82,6 +87,17 @@ private:
     // debug mode
     bool                   m_debug;
 
+    // culling. skinned mesh 의 bounds 는 world space
+    core::Bounds           m_bounds;
+    bool                   m_world_bounds;
+    bool                   m_frustum_cull;
+
+    // shadow cache. skinned mesh 를 제외하고는 기본적으로 static
+    bool                   m_static_caster;
+
+    // instanced drawing (Render::batch)
+    int                    m_instance_num;
+
     // skinning option
     bool                   m_use_skinning;
     std::vector<glm::mat4> m_buffer_transforms;
@@ -116,6 +132,8 @@ public:
     spRenderOptionsVec texture(std::string, TextureType type = TextureType::kAlbedo, int mid = 0);
     spRenderOptionsVec debug(bool);
     spRenderOptionsVec alpha(float);
+    spRenderOptionsVec frustum_cull(bool);
+    spRenderOptionsVec static_caster(bool);
 
 private:
     friend class Render;
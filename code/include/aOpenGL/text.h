@@ -1,5 +1,8 @@
 #pragma once
 #include <string>
+#include <vector>
+#include <map>
+#include <list>
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 #include "image.h"
@@ -10,31 +13,77 @@
 
 namespace a::gl {
 
+/**
+ * @brief Glyph atlas.
+ *        glyph 들은 처음 사용될 때 FreeType 으로 rasterize 해서 하나의 atlas texture 에 저장.
+ *        문자열은 vertex buffer 하나로 만들어서 저장해두기 때문에 같은 문자열은 draw call 한번으로 그림.
+ */
 class FontTexture
 {
 public:
     // Holds all state information relevant to a character as loaded using FreeType
     struct CharInfo
     {
-        unsigned int TextureID; // ID handle of the glyph texture
+        glm::vec2    UV0;       // atlas uv of the top-left corner
+        glm::vec2    UV1;       // atlas uv of the bottom-right corner
         glm::ivec2   Size;      // Size of glyph
         glm::ivec2   Bearing;   // Offset from baseline to left/top of glyph
         unsigned int Advance;   // Horizontal offset to advance to next glyph
     };
 
+    /**
+     * @brief laid-out string. vertex 위치는 font pixel 단위.
+     */
+    struct Layout
+    {
+        unsigned int  vao{0}, vbo{0};
+        int           vertex_num{0};
+        int           generation{-1};  // atlas generation used for the uvs
+    };
+
     explicit FontTexture(const std::string& font_path);
+    ~FontTexture();
 
-    const CharInfo& character(char c) const
-    {
-        return m_chars.at(c);
-    }
+    /**
+     * @param code unicode code point. rasterized on first use.
+     */
+    const CharInfo& character(unsigned int code);
+
+    /**
+     * @brief cached vertex buffer of the text. (utf-8)
+     */
+    const Layout& layout(const std::string& text, float line_space);
 
-    unsigned int vao() { return m_vao; }
-    unsigned int vbo() { return m_vbo; }
+    unsigned int texture() { return m_atlas; }
 
 private:
-    std::map<char, CharInfo> m_chars;
-    unsigned int m_vao, m_vbo;
+    void add_glyph(unsigned int code);
+    void grow_atlas();
+    void build_layout(Layout& layout, const std::string& text, float line_space);
+
+    FT_Library m_ft{nullptr};
+    FT_Face    m_face{nullptr};
+
+    std::map<unsigned int, CharInfo> m_chars;
+
+    // atlas (single channel). m_pixels keeps a copy to grow the atlas.
+    unsigned int               m_atlas{0};
+    int                        m_width, m_height;
+    std::vector<unsigned char> m_pixels;
+    int                        m_generation{0};
+
+    // shelf packing
+    int m_shelf_x{0}, m_shelf_y{0}, m_shelf_h{0};
+
+    // string cache. front of m_lru: most recently used
+    using LayoutKey = std::pair<std::string, float>;
+    struct LayoutEntry
+    {
+        Layout                         layout;
+        std::list<LayoutKey>::iterator lru; // position in m_lru
+    };
+    std::map<LayoutKey, LayoutEntry> m_layouts;
+    std::list<LayoutKey>             m_lru;
 };
 
-}
\ No newline at end of file
+}
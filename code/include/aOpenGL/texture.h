@@ -27,11 +27,19 @@ struct Texture
     std::string path{""}; 
     GLuint handle{0};
     int width{0}, height{0}, channel{0};
+
+    /**
+     * @brief TextureLoader cache 에서 사용 중인지 확인하는 용도. 
+     *        이 Texture 의 복사본이 남아있는 동안 cache 에서 지워지지 않음 (pinned).
+     */
+    std::shared_ptr<const void> ref{nullptr};
 };
 //using spTexture = std::shared_ptr<Texture>;
 
 /**
  * @brief 모든 texture들은 여기서 로드하기
+ *        load/create 로 만든 texture 는 byte budget 을 넘으면 오래 사용하지 않은 순서로 지움 (LRU).
+ *        Texture 복사본이 남아 있거나 pin 된 texture 는 지우지 않음.
  * @author ckm
  * @since Mon Aug 24 2020
  */
@@ -74,6 +82,40 @@ public:
         return instance()->_create(name, img, width, height, channel, nearest);
     }
 
+    /**
+     * @brief pin 된 texture 는 Texture 복사본이 없어도 cache 에서 지워지지 않음. pin 횟수만큼 unpin 할 것.
+     */
+    static void pin(std::string path)
+    {
+        instance()->_pin(path, 1);
+    }
+
+    static void unpin(std::string path)
+    {
+        instance()->_pin(path, -1);
+    }
+
+    /**
+     * @brief estimated gpu memory의 최대 byte 수. 0 일 경우 제한 없음.
+     */
+    static void set_budget(size_t bytes)
+    {
+        instance()->_set_budget(bytes);
+    }
+
+    /**
+     * @brief true 일 경우 upload 후에 Image cache 의 pixel data 를 해제.
+     */
+    static void free_pixels_after_upload(bool set)
+    {
+        instance()->m_free_pixels = set;
+    }
+
+    static CacheStats stats()
+    {
+        return instance()->m_stats;
+    }
+
 private:    
     /**
      * @brief singleton 
@@ -84,17 +126,35 @@ private:
         return loader;
     }
 
-    TextureLoader(){};
+    TextureLoader();
 
     Texture _create(std::string path, unsigned char* img, int width, int height, int channel, bool nearest);
+    Texture _insert(Texture texture);
+    void    _erase(std::string path);
+    void    _evict();
+    void    _pin(std::string path, int count);
+    void    _set_budget(size_t bytes);
 
     Texture _load(std::string path, int channel);
     Texture _load_hdr(std::string path);
     Texture _load_envmap(std::string path, core::Shader* to_cubemap);
 
-    std::map<std::string, Texture> m_textures;
+    struct Entry
+    {
+        Texture texture;
+        size_t bytes;
+        int pin_count;
+        std::list<std::string>::iterator lru; // position in m_lru
+    };
+
+    std::map<std::string, Entry>   m_textures;
     std::map<std::string, Texture> m_textures_hdrs;
     std::map<std::string, Texture> m_textures_env;
+
+    // front: most recently used
+    std::list<std::string> m_lru;
+    CacheStats m_stats;
+    bool m_free_pixels{false};
 };
 
 }
\ No newline at end of file
@@ -1,4 +1,6 @@
 #include "aOpenGL/app.h"
+#include "aOpenGL/profiler.h"
+#include "aOpenGL/config.h"
 
 namespace a::gl {
 
@@ -31,6 +33,18 @@ void App::key_callback(GLFWwindow* window, int key, int scancode, int action, in
         glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
     }
 
+    if(key == GLFW_KEY_F3 && action == GLFW_PRESS)
+    {
+        bool show = !(Profiler::enabled() && Profiler::overlay());
+        Profiler::set_enabled(show);
+        Profiler::set_overlay(show);
+    }
+    if(key == GLFW_KEY_F4 && action == GLFW_PRESS)
+    {
+        Profiler::set_enabled(true);
+        Profiler::start_trace(AGL_PROFILER_TRACE_FRAMES, "trace.json");
+    }
+
     if(key == GLFW_KEY_F5 && action == GLFW_PRESS)
     {
         this->capture(true);
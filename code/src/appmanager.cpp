@@ -4,10 +4,18 @@
 #include "aOpenGL/image.h"
 #include "aOpenGL/config.h"
 #include "aOpenGL/file.h"
+#include "aOpenGL/profiler.h"
+#include "headless.h"
+#include "framecapture.h"
 
 #include <iostream>
 #include <glm/gtc/quaternion.hpp>
 #include <ctime>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <cmath>
 #include <filesystem>
 
 namespace a::gl {
@@ -45,26 +53,21 @@ static std::string cur_time()
 }
 #endif
 
-static Image::spData capture_screen()
-{
-    GLint viewport[4];
-    glGetIntegerv(GL_VIEWPORT, viewport);
-    int x = viewport[0];
-    int y = viewport[1];
-    int width = viewport[2];
-    int height = viewport[3];
-    unsigned char *data = (unsigned char*) malloc((size_t) (width * height * 3)); // 3 components (R, G, B)
-    glPixelStorei(GL_PACK_ALIGNMENT, 1);
-    glReadPixels(x, y, width, height, GL_RGB, GL_UNSIGNED_BYTE, data);
+// screen capture (PBO readback + encoder threads)
+static FrameCapture frame_capture;
 
-    auto screen = std::make_shared<Image::Data>();
-    screen->path = "";
-    screen->image = data;
-    screen->width = width;
-    screen->height = height;
-    screen->channel = 3;
-    return screen;
-}
+// fixed timestep update
+using Clock = std::chrono::steady_clock;
+static double accumulator = 0.0;
+
+struct UpdateThread
+{
+    std::thread       thread;
+    std::mutex        mutex;  // held while update() runs
+    std::atomic<bool> running{false};
+    Clock::time_point last_step;
+};
+static UpdateThread update_thread;
 
 void AppManager::start_loop()
 {
@@ -82,7 +85,6 @@ void AppManager::start_loop()
         };
 
     glfwMakeContextCurrent(window);
-    glfwSwapInterval(1);
     
     glfwSetFramebufferSizeCallback(window, AppManager::on_resize);
     glfwSetKeyCallback(window, AppManager::on_key_down);
@@ -98,6 +100,88 @@ void AppManager::start_loop()
         return;
     }    
     
+    AppManager::initialize_render();
+    AppManager::start_update_thread();
+
+    bool vsync = app->vsync();
+    glfwSwapInterval(vsync ? 1 : 0);
+
+    // main loop
+
+    auto last_frame = Clock::now();
+    while(!glfwWindowShouldClose(window) && !app->is_closed())
+    {
+        int width, height;
+        glfwGetWindowSize(window, &width, &height);
+
+        if(vsync != app->vsync())
+        {
+            vsync = app->vsync();
+            glfwSwapInterval(vsync ? 1 : 0);
+        }
+
+        auto now = Clock::now();
+        double frame_time = std::chrono::duration<double>(now - last_frame).count();
+        last_frame = now;
+
+        AppManager::render_frame(width, height, frame_time);
+
+        // read back before the swap. the readback is asynchronous.
+        AppManager::capture_frame();
+
+        // event
+        {
+            AGL_PROFILE_SCOPE("swap");
+            glfwSwapBuffers(window);
+            glfwPollEvents();
+        }
+        Profiler::end_frame();
+    }
+    
+    AppManager::stop_update_thread();
+    AppManager::finish_capture();
+    glfwDestroyWindow(window);
+    glfwTerminate();
+}
+
+void AppManager::start_headless_loop(int frame_num)
+{
+    if(AppManager::app == nullptr)
+    {
+        std::cout << "AppManager::app is empty." << std::endl;
+        return;
+    }
+
+    // resolution is fixed to the app size
+    int width = app->width();
+    int height = app->height();
+
+    HeadlessContext context;
+    if(context.create(width, height) == false)
+        return;
+
+    Render::main_fbo = context.fbo();
+    AppManager::initialize_render();
+
+    // as fast as possible. no swap, no vsync.
+    // simulated time advances by one timestep per frame, regardless of the wall clock.
+    for(int frame = 0; frame_num < 0 || frame < frame_num; ++frame)
+    {
+        if(app->is_closed())
+            break;
+
+        AppManager::render_frame(width, height, app->timestep());
+        AppManager::capture_frame();
+        Profiler::end_frame();
+    }
+
+    AppManager::finish_capture();
+    Render::main_fbo = 0;
+    context.destroy();
+}
+
+void AppManager::initialize_render()
+{
     // configure global opengl state
     {
         glEnable(GL_DEPTH_TEST);
@@ -111,6 +195,7 @@ void AppManager::start_loop()
     // initialize all the shaders
     {
         ::a::gl::Render::initialize_shaders();
+        glBindFramebuffer(GL_FRAMEBUFFER, Render::main_fbo);
         glViewport(0, 0, app->width(), app->height());
     }
 
@@ -118,88 +203,215 @@ void AppManager::start_loop()
     {
         AppManager::app->start();
     }
+}
 
-    // main loop
+void AppManager::update_frame(double frame_time)
+{
+    float timestep = app->timestep();
+    if(timestep <= 0.0f)
+    {
+        app->m_alpha = 1.0f;
+        AppManager::update_app();
+        return;
+    }
 
-    while(!glfwWindowShouldClose(window))
+    // update thread: take the latest state
+    if(update_thread.running)
     {
-        int width, height;
-        glfwGetWindowSize(window, &width, &height);
+        std::lock_guard<std::mutex> lock(update_thread.mutex);
+        app->sync();
 
-        // sky color
-        {
-            auto sclr = a::gl::Render::sky_color();
-            glViewport(0, 0, width, height);
-            glClearColor(sclr.x, sclr.y, sclr.z, sclr.a);
-            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-        }
-        
-        // update
-        {
-            ::a::gl::AppManager::app->update();
-        }
-        
-        // update camera & lights
-        {
-            ::a::gl::Render::update_render_view(AppManager::app, width, height);
-        }
+        // per-model work writes the Model/Mesh state that render() draws. it runs here, on the render thread,
+        // with the update thread stopped, so that render() never sees a pose that is being written.
+        if(app->update_graph().empty() == false)
+            app->update_graph().run();
 
-        // shadow mode
-        {
-            // set viewport
-            ::a::gl::Render::set_render_mode(Render::RenderMode::SHADOW, width, height);
-            glViewport(0, 0, AGL_SHADOW_MAP_SIZE, AGL_SHADOW_MAP_SIZE);
-            glClear(GL_DEPTH_BUFFER_BIT);
-            ::a::gl::AppManager::app->render();            
-        }
+        double elapsed = std::chrono::duration<double>(Clock::now() - update_thread.last_step).count();
+        app->m_alpha = (float)std::min(elapsed / timestep, 1.0);
+        return;
+    }
 
-        // render
-        {
-            ::a::gl::Render::set_render_mode(Render::RenderMode::PBR, width, height);
-            glViewport(0, 0, width, height);
-            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-            ::a::gl::AppManager::app->render();
-        }
-        
-        // render environment map
-        {
-            //::a::gl::Render::background();
-        }
+    // accumulator
+    accumulator += frame_time;
+    int steps = 0;
+    while(accumulator >= timestep && steps < app->max_steps())
+    {
+        AppManager::update_app();
+        accumulator -= timestep;
+        steps++;
+    }
+
+    // too slow to catch up. drop the backlog instead of spiraling.
+    if(accumulator >= timestep)
+        accumulator = std::fmod(accumulator, (double)timestep);
+
+    app->m_alpha = (float)(accumulator / timestep);
+}
+
+void AppManager::update_app()
+{
+    app->update();
+
+    // per-model work scheduled by the app (pose, hierarchy, skinning palette)
+    if(app->update_graph().empty() == false)
+        app->update_graph().run();
+}
 
-        // render xray
+void AppManager::start_update_thread()
+{
+    accumulator = 0.0;
+    if(app->update_thread() == false || app->timestep() <= 0.0f)
+        return;
+
+    update_thread.last_step = Clock::now();
+    update_thread.running = true;
+    update_thread.thread = std::thread(AppManager::update_thread_loop);
+}
+
+void AppManager::stop_update_thread()
+{
+    if(update_thread.running == false)
+        return;
+    update_thread.running = false;
+    update_thread.thread.join();
+}
+
+void AppManager::update_thread_loop()
+{
+    auto timestep = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(app->timestep()));
+    auto next = Clock::now();
+    while(update_thread.running)
+    {
         {
-            ::a::gl::Render::set_render_mode(Render::RenderMode::PBR, width, height);
-            glClear(GL_DEPTH_BUFFER_BIT);
-            ::a::gl::AppManager::app->render_xray();
+            std::lock_guard<std::mutex> lock(update_thread.mutex);
+            app->update();
+            update_thread.last_step = Clock::now();
         }
+
+        next += timestep;
+        auto now = Clock::now();
+        if(now - next > timestep * app->max_steps())
+            next = now;
+        std::this_thread::sleep_until(next);
+    }
+}
+
+void AppManager::render_frame(int width, int height, double frame_time)
+{
+    Profiler::begin_frame();
+    glBindFramebuffer(GL_FRAMEBUFFER, Render::main_fbo);
+
+    // sky color
+    {
+        auto sclr = a::gl::Render::sky_color();
+        glViewport(0, 0, width, height);
+        glClearColor(sclr.x, sclr.y, sclr.z, sclr.a);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    }
+    
+    // update
+    {
+        AGL_PROFILE_SCOPE("update");
+        ::a::gl::AppManager::update_frame(frame_time);
+    }
+    
+    // update camera & lights
+    {
+        ::a::gl::Render::update_render_view(AppManager::app, width, height);
+    }
+
+    // shadow mode
+    {
+        AGL_PROFILE_GPU_SCOPE("shadow pass");
+        ::a::gl::Render::set_render_mode(Render::RenderMode::SHADOW, width, height);
         
-        // late update
+        // one pass per cascade
+        int pass_num = ::a::gl::Render::shadow_pass_num();
+        for(int i = 0; i < pass_num; ++i)
         {
-            ::a::gl::AppManager::app->late_update();
+            // set viewport
+            int size = ::a::gl::Render::set_shadow_pass(i);
+            glViewport(0, 0, size, size);
+            while(::a::gl::Render::next_shadow_stage(i))
+            {
+                ::a::gl::AppManager::app->render();
+                ::a::gl::Render::draw_batch();
+            }
         }
+    }
 
-        // event
+    // render
+    {
+        AGL_PROFILE_GPU_SCOPE("pbr pass");
+        ::a::gl::Render::set_render_mode(Render::RenderMode::PBR, width, height);
+        glViewport(0, 0, width, height);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        ::a::gl::AppManager::app->render();
+        ::a::gl::Render::draw_batch();
+        ::a::gl::Render::draw_transparent();
+    }
+    
+    // render environment map
+    {
+        //::a::gl::Render::background();
+    }
+
+    // render xray
+    {
+        AGL_PROFILE_GPU_SCOPE("xray pass");
+        ::a::gl::Render::set_render_mode(Render::RenderMode::PBR, width, height);
+        glClear(GL_DEPTH_BUFFER_BIT);
+        ::a::gl::AppManager::app->render_xray();
+        ::a::gl::Render::draw_batch();
+        ::a::gl::Render::draw_transparent();
+    }
+
+    // profiler overlay
+    {
+        Profiler::draw_overlay(width, height);
+    }
+    
+    // late update
+    {
+        AGL_PROFILE_SCOPE("late update");
+        ::a::gl::AppManager::app->late_update();
+    }
+}
+
+void AppManager::capture_frame()
+{
+    // screen capture
+    {
+        AGL_PROFILE_GPU_SCOPE("capture");
+        if(app->capture())
         {
-            glfwSwapBuffers(window);
-            glfwPollEvents();
+            FrameCapture::Settings settings;
+            settings.path    = app->capture_path();
+            settings.format  = app->capture_format();
+            settings.command = app->capture_command();
+            settings.fps     = app->capture_fps();
+            frame_capture.capture(settings);
         }
-
-        // screen capture
+        else if(frame_capture.active())
         {
-            if(app->capture())
-            {
-                static int shot = 0;
-                auto scene = capture_screen();
-                if(file_check(app->capture_path()) == false)
-                    std::filesystem::create_directories(app->capture_path());
-                Image::save_image(app->capture_path() + std::to_string(shot) + ".png", scene, true);
-                shot++;
-            }
+            // capture stopped. flush the frames and close the video stream.
+            AppManager::finish_capture();
         }
     }
-    
-    glfwDestroyWindow(window);
-    glfwTerminate();
+}
+
+void AppManager::finish_capture()
+{
+    frame_capture.finish();
+
+    auto stats = frame_capture.stats();
+    if(stats.captured > 0)
+        std::cout << "capture: " << stats.written << " written, " << stats.dropped << " dropped, " << stats.stalls << " stalls" << std::endl;
+}
+
+CaptureStats AppManager::capture_stats()
+{
+    return frame_capture.stats();
 }
 
 void AppManager::terminate()
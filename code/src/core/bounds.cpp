@@ -0,0 +1,106 @@
+#include "aOpenGL/core/bounds.h"
+#include "aOpenGL/core/mesh.h"
+#include <cmath>
+
+namespace a::gl::core {
+
+void Bounds::expand(const glm::vec3& p)
+{
+    if(radius < 0.0f)
+    {
+        min = p;
+        max = p;
+        radius = 0.0f;
+        return;
+    }
+    min = glm::min(min, p);
+    max = glm::max(max, p);
+}
+
+void Bounds::finalize()
+{
+    if(radius < 0.0f)
+        return;
+    center = 0.5f * (min + max);
+    radius = glm::length(max - center);
+}
+
+Bounds compute_bounds(const std::vector<VertexGL>& vertices)
+{
+    Bounds bounds;
+    for(const auto& v : vertices)
+        bounds.expand(v.position);
+    bounds.finalize();
+    return bounds;
+}
+
+Frustum::Frustum(const glm::mat4& m)
+{
+    // rows of the matrix (glm is column major)
+    glm::vec4 row[4];
+    for(int i = 0; i < 4; ++i)
+        row[i] = glm::vec4(m[0][i], m[1][i], m[2][i], m[3][i]);
+
+    planes[0] = row[3] + row[0]; // left
+    planes[1] = row[3] - row[0]; // right
+    planes[2] = row[3] + row[1]; // bottom
+    planes[3] = row[3] - row[1]; // top
+    planes[4] = row[3] + row[2]; // near
+    planes[5] = row[3] - row[2]; // far
+
+    for(auto& p : planes)
+    {
+        float len = glm::length(glm::vec3(p));
+        if(len > 0.0f)
+            p /= len;
+    }
+}
+
+bool Frustum::intersects_sphere(const glm::vec3& center, float radius) const
+{
+    for(const auto& p : planes)
+    {
+        if(glm::dot(glm::vec3(p), center) + p.w < -radius)
+            return false;
+    }
+    return true;
+}
+
+bool Frustum::intersects(const Bounds& bounds, const glm::mat4& model) const
+{
+    if(bounds.valid() == false)
+        return true;
+
+    glm::vec3 center  = glm::vec3(model * glm::vec4(bounds.center, 1.0f));
+    glm::vec3 extents = 0.5f * (bounds.max - bounds.min);
+    glm::vec3 axis_x  = glm::vec3(model[0]) * extents.x;
+    glm::vec3 axis_y  = glm::vec3(model[1]) * extents.y;
+    glm::vec3 axis_z  = glm::vec3(model[2]) * extents.z;
+
+    for(const auto& p : planes)
+    {
+        glm::vec3 n(p);
+        float r = std::abs(glm::dot(n, axis_x)) + std::abs(glm::dot(n, axis_y)) + std::abs(glm::dot(n, axis_z));
+        if(glm::dot(n, center) + p.w < -r)
+            return false;
+    }
+    return true;
+}
+
+bool Frustum::intersects(const Bounds& bounds) const
+{
+    if(bounds.valid() == false)
+        return true;
+
+    glm::vec3 extents = 0.5f * (bounds.max - bounds.min);
+    for(const auto& p : planes)
+    {
+        glm::vec3 n(p);
+        float r = extents.x * std::abs(n.x) + extents.y * std::abs(n.y) + extents.z * std::abs(n.z);
+        if(glm::dot(n, bounds.center) + p.w < -r)
+            return false;
+    }
+    return true;
+}
+
+}
@@ -1,20 +1,16 @@
 #include "aOpenGL/core/mesh.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
 
 namespace a::gl::core {
 
-VAO bind_mesh(std::vector<VertexGL>& varray, std::vector<unsigned int>& indices)
+/**
+ * @brief attribute layout of VertexGL. vbo 가 bind 된 상태에서 call.
+ */
+static void set_vertex_attributes()
 {
-    GLuint vao, vbo, ebo;
-
-    glGenVertexArrays(1, &vao);
-    glGenBuffers(1, &vbo);
-    glGenBuffers(1, &ebo);
-    
-    // bind the Vertex Array Object first, then bind and set vertex buffer(s), and then configure vertex attributes(s).
-    glBindVertexArray(vao);
-    glBindBuffer(GL_ARRAY_BUFFER, vbo);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(VertexGL) * varray.size(), &varray[0], GL_STATIC_DRAW);
-
     // position
     glEnableVertexAttribArray(0);
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(VertexGL), (void*)0);
@@ -46,6 +42,60 @@ VAO bind_mesh(std::vector<VertexGL>& varray, std::vector<unsigned int>& indices)
     // skinning joint weights
     glEnableVertexAttribArray(7);
     glVertexAttribPointer(7, 4, GL_FLOAT, GL_FALSE, sizeof(VertexGL), (void*)offsetof(VertexGL, skinning_weights));
+}
+
+/**
+ * @brief attribute layout of PackedVertexGL. shader 의 attribute type 은 VertexGL 과 같음 (float).
+ *        normal / tangent 는 2 component (octahedral), bitangent (4) 는 사용 안함.
+ */
+static void set_packed_vertex_attributes()
+{
+    // position, bitangent sign
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 4, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(PackedVertexGL), (void*)offsetof(PackedVertexGL, position));
+
+    // normal
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, sizeof(PackedVertexGL), (void*)offsetof(PackedVertexGL, normal));
+
+    // uv
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(PackedVertexGL), (void*)offsetof(PackedVertexGL, uv));
+
+    // tangent
+    glEnableVertexAttribArray(3);
+    glVertexAttribPointer(3, 2, GL_SHORT, GL_TRUE, sizeof(PackedVertexGL), (void*)offsetof(PackedVertexGL, tangent));
+
+    // bitangent
+    glDisableVertexAttribArray(4);
+
+    // material ID
+    glEnableVertexAttribArray(5);
+    glVertexAttribPointer(5, 1, GL_UNSIGNED_BYTE, GL_FALSE, sizeof(PackedVertexGL), (void*)offsetof(PackedVertexGL, material_id));
+
+    // skinning joint ids
+    glEnableVertexAttribArray(6);
+    glVertexAttribPointer(6, 4, GL_UNSIGNED_BYTE, GL_FALSE, sizeof(PackedVertexGL), (void*)offsetof(PackedVertexGL, skinning_idxes));
+
+    // skinning joint weights
+    glEnableVertexAttribArray(7);
+    glVertexAttribPointer(7, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(PackedVertexGL), (void*)offsetof(PackedVertexGL, skinning_weights));
+}
+
+VAO bind_mesh(std::vector<VertexGL>& varray, std::vector<unsigned int>& indices)
+{
+    GLuint vao, vbo, ebo;
+
+    glGenVertexArrays(1, &vao);
+    glGenBuffers(1, &vbo);
+    glGenBuffers(1, &ebo);
+    
+    // bind the Vertex Array Object first, then bind and set vertex buffer(s), and then configure vertex attributes(s).
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(VertexGL) * varray.size(), &varray[0], GL_STATIC_DRAW);
+
+    set_vertex_attributes();
 
     // copy index data to ebo
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
@@ -61,9 +111,261 @@ VAO bind_mesh(std::vector<VertexGL>& varray, std::vector<unsigned int>& indices)
     meshVAO.vbo = vbo;
     meshVAO.ebo = ebo;    
     meshVAO.idx_num = (int)indices.size();
+    meshVAO.bounds = compute_bounds(varray);
     return meshVAO;
 }
 
+/**
+ * @brief octahedral encoding of a unit vector. [-1, 1]^2
+ */
+static glm::vec2 oct_encode(const glm::vec3& n)
+{
+    float len = std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+    if(len <= 0.0f)
+        return glm::vec2(0, 0);
+
+    glm::vec2 p(n.x / len, n.y / len);
+    if(n.z < 0.0f)
+    {
+        p = glm::vec2((1.0f - std::abs(p.y)) * (p.x >= 0.0f ? 1.0f : -1.0f),
+                      (1.0f - std::abs(p.x)) * (p.y >= 0.0f ? 1.0f : -1.0f));
+    }
+    return p;
+}
+
+/**
+ * @brief dequantization of the packed position: offset + scale * unorm16
+ */
+static void position_range(const Bounds& bounds, glm::vec3& offset, glm::vec3& scale)
+{
+    offset = bounds.valid() ? bounds.min : glm::vec3(0.0f);
+    scale = bounds.valid() ? glm::max(bounds.max - bounds.min, glm::vec3(1e-8f)) : glm::vec3(1.0f);
+}
+
+std::vector<PackedVertexGL> pack_vertices(const std::vector<VertexGL>& varray, const Bounds& bounds)
+{
+    glm::vec3 offset, extent;
+    position_range(bounds, offset, extent);
+
+    std::vector<PackedVertexGL> packed(varray.size());
+    for(size_t i = 0; i < varray.size(); ++i)
+    {
+        const VertexGL& v = varray[i];
+        PackedVertexGL& p = packed[i];
+
+        // handedness of the tangent frame
+        float sign = glm::dot(glm::cross(v.normal, v.tangent), v.bitangent) < 0.0f ? 0.0f : 1.0f;
+        glm::vec3 q = (v.position - offset) / extent;
+        p.position[0] = glm::packUnorm2x16(glm::vec2(q.x, q.y));
+        p.position[1] = glm::packUnorm2x16(glm::vec2(q.z, sign));
+
+        p.normal  = glm::packSnorm2x16(oct_encode(v.normal));
+        p.tangent = glm::packSnorm2x16(oct_encode(v.tangent));
+        p.uv      = glm::packHalf2x16(v.uv);
+
+        // weights sum to exactly 255, the rounding error goes to the largest one
+        float sum = v.skinning_weights.x + v.skinning_weights.y + v.skinning_weights.z + v.skinning_weights.w;
+        int total = 0, largest = 0;
+        for(int k = 0; k < 4; ++k)
+        {
+            int w = sum > 0.0f ? (int)std::round(255.0f * v.skinning_weights[k] / sum) : 0;
+            p.skinning_idxes[k] = (uint8_t)v.skinning_idxes[k];
+            p.skinning_weights[k] = (uint8_t)std::min(255, std::max(0, w));
+            total += p.skinning_weights[k];
+            if(v.skinning_weights[k] > v.skinning_weights[largest])
+                largest = k;
+        }
+        if(sum > 0.0f)
+            p.skinning_weights[largest] = (uint8_t)std::min(255, std::max(0, p.skinning_weights[largest] + 255 - total));
+
+        p.material_id = (uint8_t)v.material_id.x;
+        p.padding[0] = p.padding[1] = p.padding[2] = 0;
+    }
+    return packed;
+}
+
+VAO bind_packed_mesh(std::vector<VertexGL>& varray, std::vector<unsigned int>& indices)
+{
+    // uint8 indices
+    for(const auto& v : varray)
+    {
+        float max_idx = std::max(std::max(v.skinning_idxes.x, v.skinning_idxes.y), std::max(v.skinning_idxes.z, v.skinning_idxes.w));
+        if(max_idx > 255.0f || v.material_id.x > 255.0f)
+            return bind_mesh(varray, indices);
+    }
+
+    Bounds bounds = compute_bounds(varray);
+    std::vector<PackedVertexGL> packed = pack_vertices(varray, bounds);
+
+    GLuint vao, vbo, ebo;
+    glGenVertexArrays(1, &vao);
+    glGenBuffers(1, &vbo);
+    glGenBuffers(1, &ebo);
+
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(PackedVertexGL) * packed.size(), packed.data(), GL_STATIC_DRAW);
+
+    set_packed_vertex_attributes();
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned int) * indices.size(), indices.data(), GL_STATIC_DRAW);
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+
+    VAO meshVAO;
+    meshVAO.vao = vao;
+    meshVAO.vbo = vbo;
+    meshVAO.ebo = ebo;
+    meshVAO.idx_num = (int)indices.size();
+    meshVAO.bounds = bounds;
+    meshVAO.packed = true;
+    position_range(bounds, meshVAO.position_offset, meshVAO.position_scale);
+    return meshVAO;
+}
+
+VAO bind_instanced(const VAO& mesh, GLuint instance_vbo)
+{
+    GLuint vao;
+    glGenVertexArrays(1, &vao);
+    glBindVertexArray(vao);
+
+    // shared vertex data
+    glBindBuffer(GL_ARRAY_BUFFER, mesh.vbo);
+    if(mesh.packed)
+        set_packed_vertex_attributes();
+    else
+        set_vertex_attributes();
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.ebo);
+
+    // model matrix takes 4 locations
+    glBindBuffer(GL_ARRAY_BUFFER, instance_vbo);
+    for(int i = 0; i < 4; ++i)
+    {
+        glEnableVertexAttribArray(8 + i);
+        glVertexAttribPointer(8 + i, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceGL), (void*)(offsetof(InstanceGL, model) + sizeof(glm::vec4) * i));
+        glVertexAttribDivisor(8 + i, 1);
+    }
+
+    // color
+    glEnableVertexAttribArray(12);
+    glVertexAttribPointer(12, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceGL), (void*)offsetof(InstanceGL, color));
+    glVertexAttribDivisor(12, 1);
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+
+    VAO instanced = mesh;
+    instanced.vao = vao;
+    return instanced;
+}
+
+float compute_skin_radius(const std::vector<VertexGL>& varray, const std::vector<glm::mat4>& bind_trf_inv)
+{
+    // bind position of the joints
+    std::vector<glm::vec3> joint_pos(bind_trf_inv.size());
+    for(int i = 0; i < (int)bind_trf_inv.size(); ++i)
+        joint_pos.at(i) = glm::vec3(glm::inverse(bind_trf_inv.at(i))[3]);
+
+    // a skinned vertex is a blend of the rigid transforms of all its joints.
+    // it stays within its bind distance to every influencing joint from that joint's box.
+    float radius = 0.0f;
+    for(const auto& v : varray)
+    {
+        for(int k = 0; k < 4; ++k)
+        {
+            int bidx = (int)v.skinning_idxes[k];
+            if(v.skinning_weights[k] <= 0.0f || bidx < 0 || bidx >= (int)joint_pos.size())
+                continue;
+            radius = std::max(radius, glm::length(v.position - joint_pos.at(bidx)));
+        }
+    }
+    return radius;
+}
+
+// VertexGL is a plain array of floats, so vertices can be hashed and compared as such
+static constexpr int VERTEX_FLOATS = sizeof(VertexGL) / sizeof(float);
+static_assert(sizeof(VertexGL) == VERTEX_FLOATS * sizeof(float), "VertexGL must not have padding");
+
+/**
+ * @brief -0.0f -> 0.0f so that the two zeros weld together
+ */
+static void canonical_vertex(const VertexGL& v, uint32_t out[VERTEX_FLOATS])
+{
+    float f[VERTEX_FLOATS];
+    std::memcpy(f, &v, sizeof(VertexGL));
+    for(int i = 0; i < VERTEX_FLOATS; ++i)
+    {
+        if(f[i] == 0.0f)
+            f[i] = 0.0f;
+    }
+    std::memcpy(out, f, sizeof(VertexGL));
+}
+
+static uint64_t hash_vertex(const uint32_t key[VERTEX_FLOATS])
+{
+    uint64_t hash = 14695981039346656037ULL;
+    for(int i = 0; i < VERTEX_FLOATS; ++i)
+    {
+        hash ^= key[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash ^ (hash >> 32);
+}
+
+size_t weld_vertices(std::vector<VertexGL>& varray, std::vector<unsigned int>& indices)
+{
+    const size_t vnum = varray.size();
+    if(vnum == 0)
+        return 0;
+
+    // open addressing table of indices into welded. load factor <= 0.5
+    const unsigned int empty = 0xffffffffu;
+    size_t table_size = 1;
+    while(table_size < vnum * 2)
+        table_size <<= 1;
+    std::vector<unsigned int> table(table_size, empty);
+
+    std::vector<VertexGL>     welded;
+    std::vector<uint32_t>     keys;   // canonical floats of welded vertices
+    std::vector<unsigned int> remap(vnum);
+    welded.reserve(vnum);
+    keys.reserve(vnum * VERTEX_FLOATS);
+
+    uint32_t key[VERTEX_FLOATS];
+    for(size_t i = 0; i < vnum; ++i)
+    {
+        canonical_vertex(varray[i], key);
+        size_t slot = hash_vertex(key) & (table_size - 1);
+        while(true)
+        {
+            unsigned int w = table[slot];
+            if(w == empty)
+            {
+                w = (unsigned int)welded.size();
+                table[slot] = w;
+                welded.push_back(varray[i]);
+                keys.insert(keys.end(), key, key + VERTEX_FLOATS);
+                remap[i] = w;
+                break;
+            }
+            if(std::memcmp(&keys[(size_t)w * VERTEX_FLOATS], key, sizeof(key)) == 0)
+            {
+                remap[i] = w;
+                break;
+            }
+            slot = (slot + 1) & (table_size - 1);
+        }
+    }
+
+    for(auto& idx : indices)
+        idx = remap.at(idx);
+
+    varray.swap(welded);
+    return varray.size();
+}
+
 void compute_tangent_space(std::vector<glm::vec3>& out_tan, 
                            std::vector<glm::vec3>& out_bitan,
                            const std::vector<glm::vec3>& positions, 
@@ -0,0 +1,283 @@
+#include "aOpenGL/core/meshopt.h"
+#include "aOpenGL/core/mesh.h"
+#include <algorithm>
+
+namespace a::gl::core {
+
+/**
+ * @brief FIFO post-transform cache. vertex 가 들어온 뒤 miss 가 cache_size 번 나기 전까지 cache 에 있음.
+ */
+struct FifoCache
+{
+    std::vector<size_t> time; // miss count when the vertex entered the cache
+    size_t              now;
+    size_t              size;
+
+    FifoCache(size_t vertex_num, int cache_size) : time(vertex_num, 0), now(cache_size + 1), size(cache_size) {}
+
+    /**
+     * @return 1 if v was not in the cache (transformed)
+     */
+    int access(unsigned int v)
+    {
+        if(now - time[v] > size)
+        {
+            time[v] = now++;
+            return 1;
+        }
+        return 0;
+    }
+
+    int access_triangle(const unsigned int* tri)
+    {
+        return access(tri[0]) + access(tri[1]) + access(tri[2]);
+    }
+
+    void reset() { now += size + 1; }
+};
+
+VertexCacheStats analyze_vertex_cache(const std::vector<unsigned int>& indices, size_t vertex_num, int cache_size)
+{
+    VertexCacheStats stats;
+    if(indices.size() < 3)
+        return stats;
+
+    FifoCache cache(vertex_num, cache_size);
+    std::vector<char> used(vertex_num, 0);
+    size_t used_num = 0;
+    for(auto v : indices)
+    {
+        stats.transformed += cache.access(v);
+        if(used[v] == 0)
+        {
+            used[v] = 1;
+            used_num++;
+        }
+    }
+    stats.acmr = (float)stats.transformed / (indices.size() / 3);
+    stats.atvr = (float)stats.transformed / used_num;
+    return stats;
+}
+
+void optimize_vertex_cache(std::vector<unsigned int>& indices, size_t vertex_num, int cache_size)
+{
+    const size_t tri_num = indices.size() / 3;
+    if(tri_num == 0 || vertex_num == 0)
+        return;
+
+    // vertex -> triangles
+    std::vector<unsigned int> offsets(vertex_num + 1, 0);
+    for(size_t i = 0; i < tri_num * 3; ++i)
+        offsets[indices[i] + 1]++;
+    for(size_t v = 0; v < vertex_num; ++v)
+        offsets[v + 1] += offsets[v];
+
+    std::vector<unsigned int> adjacency(tri_num * 3);
+    {
+        std::vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+        for(size_t i = 0; i < tri_num * 3; ++i)
+            adjacency[fill[indices[i]]++] = (unsigned int)(i / 3);
+    }
+
+    // number of triangles not emitted yet
+    std::vector<int> live(vertex_num);
+    for(size_t v = 0; v < vertex_num; ++v)
+        live[v] = (int)(offsets[v + 1] - offsets[v]);
+
+    std::vector<size_t>       time(vertex_num, 0);
+    size_t                    now = cache_size + 1;
+    std::vector<char>         emitted(tri_num, 0);
+    std::vector<unsigned int> dead_end;     // stack of the recently used vertices
+    std::vector<unsigned int> candidates;
+    std::vector<unsigned int> result;
+    result.reserve(tri_num * 3);
+    size_t cursor = 0;
+
+    auto skip_dead_end = [&]() -> long long
+    {
+        while(dead_end.empty() == false)
+        {
+            unsigned int d = dead_end.back();
+            dead_end.pop_back();
+            if(live[d] > 0)
+                return d;
+        }
+        for(; cursor < vertex_num; ++cursor)
+        {
+            if(live[cursor] > 0)
+                return (long long)cursor;
+        }
+        return -1;
+    };
+
+    long long fan = skip_dead_end();
+    while(fan >= 0)
+    {
+        // emit all the remaining triangles around the fanning vertex
+        candidates.clear();
+        for(unsigned int k = offsets[fan]; k < offsets[fan + 1]; ++k)
+        {
+            unsigned int t = adjacency[k];
+            if(emitted[t])
+                continue;
+            emitted[t] = 1;
+
+            for(int c = 0; c < 3; ++c)
+            {
+                unsigned int v = indices[t * 3 + c];
+                result.push_back(v);
+                dead_end.push_back(v);
+                candidates.push_back(v);
+                live[v]--;
+                if(now - time[v] > (size_t)cache_size)
+                    time[v] = now++;
+            }
+        }
+
+        // next: the oldest candidate that is still in the cache after emitting its remaining triangles
+        long long next = -1, best = -1;
+        for(auto v : candidates)
+        {
+            if(live[v] <= 0)
+                continue;
+            long long age = (long long)(now - time[v]);
+            long long priority = (age + 2 * live[v] <= cache_size) ? age : 0;
+            if(priority > best)
+            {
+                best = priority;
+                next = v;
+            }
+        }
+        fan = next >= 0 ? next : skip_dead_end();
+    }
+
+    indices.swap(result);
+}
+
+void optimize_overdraw(std::vector<unsigned int>& indices, const std::vector<VertexGL>& vertices, float threshold, int cache_size)
+{
+    const size_t tri_num = indices.size() / 3;
+    if(tri_num < 2)
+        return;
+
+    // hard boundaries: all 3 vertices miss, i.e. the cache order restarts anyway
+    std::vector<size_t> hard;
+    FifoCache cache(vertices.size(), cache_size);
+    for(size_t t = 0; t < tri_num; ++t)
+    {
+        if(cache.access_triangle(&indices[t * 3]) == 3 || t == 0)
+            hard.push_back(t);
+    }
+
+    // soft boundaries: cut a hard cluster where its ACMR so far is within threshold of the whole cluster
+    std::vector<size_t> starts;
+    for(size_t c = 0; c < hard.size(); ++c)
+    {
+        size_t begin = hard[c];
+        size_t end = c + 1 < hard.size() ? hard[c + 1] : tri_num;
+
+        cache.reset();
+        size_t misses = 0;
+        for(size_t t = begin; t < end; ++t)
+            misses += cache.access_triangle(&indices[t * 3]);
+        float target = threshold * misses / (end - begin);
+
+        cache.reset();
+        starts.push_back(begin);
+        size_t cluster_begin = begin, cluster_misses = 0;
+        for(size_t t = begin; t < end; ++t)
+        {
+            cluster_misses += cache.access_triangle(&indices[t * 3]);
+            if(t + 1 < end && cluster_misses <= target * (t + 1 - cluster_begin))
+            {
+                starts.push_back(t + 1);
+                cluster_begin = t + 1;
+                cluster_misses = 0;
+                cache.reset();
+            }
+        }
+    }
+
+    // area weighted centroid and normal of each cluster
+    struct Cluster
+    {
+        size_t    begin, end;
+        glm::vec3 centroid;
+        glm::vec3 normal;
+        float     key;
+    };
+    std::vector<Cluster> clusters(starts.size());
+    glm::vec3 mesh_centroid(0.0f);
+    float     mesh_area = 0.0f;
+    for(size_t c = 0; c < starts.size(); ++c)
+    {
+        Cluster& cluster = clusters[c];
+        cluster.begin = starts[c];
+        cluster.end = c + 1 < starts.size() ? starts[c + 1] : tri_num;
+        cluster.centroid = glm::vec3(0.0f);
+        cluster.normal = glm::vec3(0.0f);
+
+        float area = 0.0f;
+        for(size_t t = cluster.begin; t < cluster.end; ++t)
+        {
+            const glm::vec3& p0 = vertices[indices[t * 3 + 0]].position;
+            const glm::vec3& p1 = vertices[indices[t * 3 + 1]].position;
+            const glm::vec3& p2 = vertices[indices[t * 3 + 2]].position;
+            glm::vec3 n = glm::cross(p1 - p0, p2 - p0);
+            float a = 0.5f * glm::length(n);
+
+            cluster.centroid += (a / 3.0f) * (p0 + p1 + p2);
+            cluster.normal += n;
+            area += a;
+        }
+        mesh_centroid += cluster.centroid;
+        mesh_area += area;
+        if(area > 0.0f)
+            cluster.centroid /= area;
+    }
+    if(mesh_area > 0.0f)
+        mesh_centroid /= mesh_area;
+
+    // clusters facing away from the center occlude the others: draw them first
+    for(auto& cluster : clusters)
+    {
+        float len = glm::length(cluster.normal);
+        cluster.key = len > 0.0f ? glm::dot(cluster.centroid - mesh_centroid, cluster.normal / len) : 0.0f;
+    }
+    std::stable_sort(clusters.begin(), clusters.end(), [](const Cluster& a, const Cluster& b){ return a.key > b.key; });
+
+    std::vector<unsigned int> result;
+    result.reserve(tri_num * 3);
+    for(const auto& cluster : clusters)
+        result.insert(result.end(), indices.begin() + cluster.begin * 3, indices.begin() + cluster.end * 3);
+    result.insert(result.end(), indices.begin() + tri_num * 3, indices.end());
+    indices.swap(result);
+}
+
+void optimize_vertex_fetch(std::vector<VertexGL>& vertices, std::vector<unsigned int>& indices)
+{
+    const unsigned int unused = 0xffffffffu;
+    std::vector<unsigned int> remap(vertices.size(), unused);
+    std::vector<VertexGL> result;
+    result.reserve(vertices.size());
+
+    for(auto& idx : indices)
+    {
+        if(remap[idx] == unused)
+        {
+            remap[idx] = (unsigned int)result.size();
+            result.push_back(vertices[idx]);
+        }
+        idx = remap[idx];
+    }
+    vertices.swap(result);
+}
+
+void optimize_mesh(std::vector<VertexGL>& vertices, std::vector<unsigned int>& indices, float threshold, int cache_size)
+{
+    optimize_vertex_cache(indices, vertices.size(), cache_size);
+    optimize_overdraw(indices, vertices, threshold, cache_size);
+    optimize_vertex_fetch(vertices, indices);
+}
+
+}
@@ -1,7 +1,13 @@
 #include "aOpenGL/core/shader.h"
+#include "aOpenGL/profiler.h"
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <random>
 #include <sstream>
+#include <vector>
 
 namespace a::gl::core {
 
@@ -67,10 +73,9 @@ static void checkProgramCompileError(GLuint handle)
     }
 }
 
-static GLuint load(std::string filename, GLenum shaderType)
+static GLuint compile(const std::string& code, GLenum shaderType)
 {
-    std::string shaderCodeStr = a::gl::core::loadCode(filename);
-    const char* shaderCode = shaderCodeStr.c_str();
+    const char* shaderCode = code.c_str();
 
     // compile shaders
     int shader = glCreateShader(shaderType);
@@ -82,6 +87,163 @@ static GLuint load(std::string filename, GLenum shaderType)
     return shader;
 }
 
+// program binary cache ---------------------------------------------- //
+
+std::string Shader::s_cache_dir;
+int         Shader::s_cache_hits   = 0;
+int         Shader::s_cache_misses = 0;
+
+static const char     BINARY_MAGIC[4] = {'A', 'G', 'L', 'B'};
+static const uint32_t BINARY_VERSION  = 1;
+
+struct BinaryHeader
+{
+    char     magic[4];
+    uint32_t version;
+    uint32_t format;
+    uint32_t length;
+};
+
+/**
+ * @brief GL 4.1 or ARB_get_program_binary with at least one binary format
+ */
+static bool binary_supported()
+{
+    static int supported = -1;
+    if(supported < 0)
+    {
+        GLint format_num = 0;
+        if(glGetProgramBinary && glProgramBinary && glProgramParameteri)
+            glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &format_num);
+        supported = format_num > 0 ? 1 : 0;
+    }
+    return supported == 1;
+}
+
+// FNV-1a 64
+static void hash_bytes(uint64_t& hash, const char* data, size_t size)
+{
+    for(size_t i = 0; i < size; ++i)
+    {
+        hash ^= (unsigned char)data[i];
+        hash *= 1099511628211ULL;
+    }
+    hash ^= 0xff; // separator, so that ("ab", "c") != ("a", "bc")
+    hash *= 1099511628211ULL;
+}
+
+static void hash_string(uint64_t& hash, GLenum name)
+{
+    const char* str = (const char*)glGetString(name);
+    hash_bytes(hash, str, str ? std::strlen(str) : 0);
+}
+
+std::string Shader::cache_path() const
+{
+    if(s_cache_dir.empty() || binary_supported() == false)
+        return "";
+
+    // a driver update invalidates the binaries, so the driver is a part of the key
+    uint64_t hash = 14695981039346656037ULL;
+    hash_string(hash, GL_VENDOR);
+    hash_string(hash, GL_RENDERER);
+    hash_string(hash, GL_VERSION);
+    hash_bytes(hash, m_vertexCode.data(), m_vertexCode.size());
+    hash_bytes(hash, m_fragmentCode.data(), m_fragmentCode.size());
+    hash_bytes(hash, m_geometryCode.data(), m_geometryCode.size());
+
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)hash);
+    return s_cache_dir + "/" + name;
+}
+
+bool Shader::load_binary(const std::string& path)
+{
+    std::ifstream file(path, std::ios::binary);
+    if(!file)
+        return false;
+
+    BinaryHeader header;
+    std::vector<char> data;
+    if(file.read((char*)&header, sizeof(header)))
+    {
+        if(std::memcmp(header.magic, BINARY_MAGIC, 4) == 0 && header.version == BINARY_VERSION && header.length > 0)
+        {
+            data.resize(header.length);
+            if(!file.read(data.data(), data.size()))
+                data.clear();
+        }
+    }
+    file.close();
+
+    GLint success = 0;
+    GLuint prog = GL_INVALID_INDEX;
+    if(data.empty() == false)
+    {
+        prog = glCreateProgram();
+        glProgramBinary(prog, header.format, data.data(), (GLsizei)data.size());
+        glGetProgramiv(prog, GL_LINK_STATUS, &success);
+    }
+
+    if(!success)
+    {
+        // stale or corrupted binary (e.g. driver update): drop it and compile from the source
+        if(prog != GL_INVALID_INDEX)
+            glDeleteProgram(prog);
+        while(glGetError() != GL_NO_ERROR);
+        std::remove(path.c_str());
+        return false;
+    }
+
+    m_program = prog;
+    return true;
+}
+
+void Shader::save_binary(const std::string& path) const
+{
+    GLint length = 0;
+    glGetProgramiv(m_program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if(length <= 0)
+        return;
+
+    BinaryHeader header;
+    std::memcpy(header.magic, BINARY_MAGIC, 4);
+    header.version = BINARY_VERSION;
+
+    std::vector<char> data(length);
+    GLenum format = 0;
+    glGetProgramBinary(m_program, length, &length, &format, data.data());
+    header.format = format;
+    header.length = (uint32_t)length;
+
+    // write to a temporary file first, so that another process never reads a half written binary.
+    // the name is unique so that processes starting together don't write the same file
+    std::error_code ec;
+    std::filesystem::create_directories(s_cache_dir, ec);
+    std::random_device random;
+    char suffix[32];
+    std::snprintf(suffix, sizeof(suffix), ".%08x%08x.tmp", (unsigned int)random(), (unsigned int)random());
+    std::string tmp = path + suffix;
+    {
+        std::ofstream file(tmp, std::ios::binary);
+        if(!file)
+            return;
+        file.write((const char*)&header, sizeof(header));
+        file.write(data.data(), header.length);
+        if(!file)
+        {
+            file.close();
+            std::remove(tmp.c_str());
+            return;
+        }
+    }
+    std::filesystem::rename(tmp, path, ec);
+    if(ec)
+        std::remove(tmp.c_str());
+}
+
+// shader ------------------------------------------------------------ //
+
 Shader::Shader() : m_program(GL_INVALID_INDEX), 
                    m_vertexShader(GL_INVALID_INDEX),
                    m_fragmentShader(GL_INVALID_INDEX),
@@ -98,137 +260,187 @@ Shader::Shader(std::string vsPath, std::string fsPath):
     m_view_updated(false),
     m_texture_updated(false)
 {
-    m_vertexShader = load(vsPath, GL_VERTEX_SHADER);
-    m_fragmentShader = load(fsPath, GL_FRAGMENT_SHADER);
+    m_vertexCode = loadCode(vsPath);
+    m_fragmentCode = loadCode(fsPath);
 }
 
 Shader Shader::geometry(std::string path)
 {
-    m_geometryShader = load(path, GL_GEOMETRY_SHADER);
+    m_geometryCode = loadCode(path);
     return *this;
 }
 
 Shader Shader::build()
 {
-    GLuint prog = glCreateProgram();
-    glAttachShader(prog, m_vertexShader);
-    glAttachShader(prog, m_fragmentShader);
-    if(m_geometryShader != GL_INVALID_INDEX)
-        glAttachShader(prog, m_geometryShader);
-
-    glLinkProgram(prog);
-    checkProgramCompileError(prog);
-
-    // delete the shaders as they're linked into our program now and no longer necessery
-    glDeleteShader(m_vertexShader);
-    glDeleteShader(m_fragmentShader);
-    if(m_geometryShader != GL_INVALID_INDEX)
+    std::string path = cache_path();
+    if(path.empty() == false && load_binary(path))
     {
-        glDeleteShader(m_geometryShader);
+        s_cache_hits++;
     }
-    
-    m_program = prog;
+    else
+    {
+        m_vertexShader = compile(m_vertexCode, GL_VERTEX_SHADER);
+        m_fragmentShader = compile(m_fragmentCode, GL_FRAGMENT_SHADER);
+        if(m_geometryCode.empty() == false)
+            m_geometryShader = compile(m_geometryCode, GL_GEOMETRY_SHADER);
+
+        GLuint prog = glCreateProgram();
+        glAttachShader(prog, m_vertexShader);
+        glAttachShader(prog, m_fragmentShader);
+        if(m_geometryShader != GL_INVALID_INDEX)
+            glAttachShader(prog, m_geometryShader);
+
+        if(path.empty() == false)
+            glProgramParameteri(prog, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+
+        glLinkProgram(prog);
+        checkProgramCompileError(prog);
+
+        // delete the shaders as they're linked into our program now and no longer necessery
+        glDeleteShader(m_vertexShader);
+        glDeleteShader(m_fragmentShader);
+        if(m_geometryShader != GL_INVALID_INDEX)
+        {
+            glDeleteShader(m_geometryShader);
+        }
+        m_vertexShader = m_fragmentShader = m_geometryShader = GL_INVALID_INDEX;
+
+        m_program = prog;
+
+        GLint success = 0;
+        glGetProgramiv(prog, GL_LINK_STATUS, &success);
+        if(path.empty() == false && success)
+        {
+            s_cache_misses++;
+            save_binary(path);
+        }
+    }
+
+    // the sources are not needed anymore
+    m_vertexCode.clear();
+    m_fragmentCode.clear();
+    m_geometryCode.clear();
     return *this;
 }
 
 void Shader::setBool(std::string name, bool value) const
 {
     glUniform1i(glGetUniformLocation(m_program, name.c_str()), (int)value);
+    Profiler::count_uniform();
 }
 
 void Shader::setInt(std::string name, int value) const
 {
     glUniform1i(glGetUniformLocation(m_program, name.c_str()), value);
+    Profiler::count_uniform();
 }
 
 void Shader::setMultipleInt(std::string name, int num, const int* value) const
 {
     glUniform1iv(glGetUniformLocation(m_program, name.c_str()), num, &(value[0]));
+    Profiler::count_uniform();
 }
 
 void Shader::setFloat(std::string name, float value) const
 {
     glUniform1f(glGetUniformLocation(m_program, name.c_str()), value);
+    Profiler::count_uniform();
 }
 
 void Shader::setVec2(std::string name, glm::vec2 value) const
 {
     glUniform2fv(glGetUniformLocation(m_program, name.c_str()), 1, &value[0]);
+    Profiler::count_uniform();
 }
 
 void Shader::setVec2(std::string name, float x, float y) const
 {
     glUniform2f(glGetUniformLocation(m_program, name.c_str()), x, y);
+    Profiler::count_uniform();
 }
 
 void Shader::setVec3(std::string name, glm::vec3 value) const
 {
     glUniform3fv(glGetUniformLocation(m_program, name.c_str()), 1, &value[0]);
+    Profiler::count_uniform();
 }
 
 void Shader::setVec3(std::string name, float x, float y, float z) const
 {
     glUniform3f(glGetUniformLocation(m_program, name.c_str()), x, y, z);
+    Profiler::count_uniform();
 }
 
 void Shader::setVec4(std::string name, const glm::vec4 value) const
 {
     glUniform4fv(glGetUniformLocation(m_program, name.c_str()), 1, &value[0]);
+    Profiler::count_uniform();
 }
 
 void Shader::setVec4(std::string name, float x, float y, float z, float w) const
 {
     glUniform4f(glGetUniformLocation(m_program, name.c_str()), x, y, z, w);
+    Profiler::count_uniform();
 }
 
 void Shader::setIvec3(std::string name, glm::ivec3 value) const
 {
     glUniform3iv(glGetUniformLocation(m_program, name.c_str()), 1, &value[0]);
+    Profiler::count_uniform();
 }
 
 void Shader::setIvec4(std::string name, glm::ivec4 value) const
 {
     glUniform4iv(glGetUniformLocation(m_program, name.c_str()), 1, &value[0]);
+    Profiler::count_uniform();
 }
 
 void Shader::setMat2(std::string name, glm::mat2 mat) const
 {
     glUniformMatrix2fv(glGetUniformLocation(m_program, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+    Profiler::count_uniform();
 }
 
 void Shader::setMat3(std::string name, glm::mat3 mat) const
 {
     glUniformMatrix3fv(glGetUniformLocation(m_program, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+    Profiler::count_uniform();
 }
 
 void Shader::setMat4(std::string name, glm::mat4 mat) const
 {
     glUniformMatrix4fv(glGetUniformLocation(m_program, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+    Profiler::count_uniform();
 }
 
 void Shader::setMultipleMat4(std::string name, int numberOfMatrices ,const glm::mat4* matrices) const
 {
     glUniformMatrix4fv(glGetUniformLocation(m_program, name.c_str()), numberOfMatrices, GL_FALSE, &(matrices[0])[0][0]);
+    Profiler::count_uniform();
 }
 
 void Shader::setMultipleVec4(std::string name, int numberOfVectors ,const glm::vec4* vectors) const
 {
     glUniform4fv(glGetUniformLocation(m_program, name.c_str()), numberOfVectors, &(vectors[0][0]));
+    Profiler::count_uniform();
 }
 
 void Shader::setMultipleVec3(std::string name, int numberOfVectors ,const glm::vec3* vectors) const
 {
     glUniform3fv(glGetUniformLocation(m_program, name.c_str()), numberOfVectors, &(vectors[0][0]));
+    Profiler::count_uniform();
 }
 
 void Shader::setMultipleIvec3(std::string name, int numberOfVectors,  const glm::ivec3* vectors) const
 {
     glUniform3iv(glGetUniformLocation(m_program, name.c_str()), numberOfVectors, &(vectors[0][0]));
+    Profiler::count_uniform();
 }
 
 void Shader::setMultipleIvec4(std::string name, int numberOfVectors,  const glm::ivec4* vectors) const
 {
     glUniform4iv(glGetUniformLocation(m_program, name.c_str()), numberOfVectors, &(vectors[0][0]));
+    Profiler::count_uniform();
 }
 
 }
\ No newline at end of file
@@ -4,10 +4,18 @@
 #include "aOpenGL/joint.h"
 #include "aOpenGL/mesh.h"
 #include "aOpenGL/material.h"
+#include "aOpenGL/config.h"
+#include "aOpenGL/jobs.h"
 
 #include "aOpenGL/core/mesh.h"
+#include "aOpenGL/core/meshopt.h"
 #include "fbx/fbxparser.h"
+#include "fbx/modelcache.h"
+#include <atomic>
+#include <chrono>
 #include <iostream>
+#include <mutex>
+#include <thread>
 
 namespace a::gl {
 
@@ -29,58 +37,49 @@ static a::gl::TextureType find_texture_type(std::string type_name)
         return iter->second;
 }
 
-static std::vector<float> get_timestep(float t0, float te, float dt)
-{
-    std::vector<float> timestep;
-    int nof = ((te - t0) / dt + 1);
-    timestep.reserve(nof);
-    for(int i = 0; i < nof; ++i)
-    {
-        float t = i * dt + t0;
-        timestep.push_back(t);
-    }
-    return timestep;
-}
-
+/**
+ * @brief FBX SDK 는 model cache 가 없거나 motion 을 읽을 때만 사용.
+ */
 struct FBX::Parser
 {
-    FBXParser parser;
-    CharacterData charData;
-    std::vector<MeshData> meshData;
+    std::string path;
+    float       scale;
+    ModelData   model;
+    std::unique_ptr<FBXParser> parser;
 
     Parser(const std::string& path, float scale):
-        parser(path), charData(), meshData()
+        path(path), scale(scale), model(), parser()
+    {}
+
+    FBXParser& fbx()
     {
-        parser.mesh_data(meshData, scale);
-        parser.character_data(charData, scale);
+        if(parser == nullptr)
+            parser = std::make_unique<FBXParser>(path);
+        return *parser;
     }
 };
 
-FBX::FBX(std::string path, float scale)
+/**
+ * @brief joints, and meshes as they are uploaded: material ids assigned, welded and reordered
+ */
+static ModelData parse_model(FBXParser& parser, float scale)
 {
-    m_parser = std::make_unique<FBX::Parser>(path, scale);
-    m_scale = scale;
-}
-
-FBX::~FBX()
-{}
+    std::vector<MeshData> meshData;
+    CharacterData charData;
+    parser.mesh_data(meshData, scale);
+    parser.character_data(charData, scale);
 
-std::vector<std::pair<core::spMeshGL, vMaterial>> FBX::meshGLs()
-{
-    auto& meshData = m_parser->meshData;
-    
-    std::vector<std::pair<core::spMeshGL, vMaterial>> results;
-    int n = meshData.size();
-    results.reserve(n);
+    ModelData model;
+    for(const auto& jnt : charData.joint_data)
+        model.joints.push_back(ModelData::Joint{jnt.name, jnt.parent_index, jnt.local_T, jnt.local_S, jnt.local_R, jnt.pre_R});
 
     for(auto& data : meshData)
     {
-        auto mesh_gl = std::make_shared<core::MeshGL>();
-
+        ModelData::Mesh mesh;
         if(data.is_skinned)
         {
-            mesh_gl->is_skinned = true;
-            mesh_gl->vertices = a::gl::core::to_vertex_array(
+            mesh.is_skinned = true;
+            mesh.vertices = a::gl::core::to_vertex_array(
                 data.positions,
                 data.normals,
                 data.uvs,
@@ -91,14 +90,14 @@ std::vector<std::pair<core::spMeshGL, vMaterial>> FBX::meshGLs()
                 data.skinning_data.joint_weights1,
                 1.0);
             
-            mesh_gl->joint_order = data.skinning_data.joint_order;
-            mesh_gl->name_to_idx = data.skinning_data.name2idx;
-            mesh_gl->jonit_bind_trf_inv = data.skinning_data.offset_transform;
+            mesh.joint_order = data.skinning_data.joint_order;
+            mesh.name_to_idx = data.skinning_data.name2idx;
+            mesh.joint_bind_trf_inv = data.skinning_data.offset_transform;
         }
         else
         {
-            mesh_gl->is_skinned = false;
-            mesh_gl->vertices = a::gl::core::to_vertex_array(
+            mesh.is_skinned = false;
+            mesh.vertices = a::gl::core::to_vertex_array(
                 data.positions,
                 data.normals,
                 data.uvs,
@@ -107,33 +106,26 @@ std::vector<std::pair<core::spMeshGL, vMaterial>> FBX::meshGLs()
                 data.indices,
                 1.0);
         }
-#if 1
-        // set materials and texture
+
+        // materials and textures
         std::map<int, int> id_to_materialIdx;
-        std::vector<Material> gl_materials;
         for(int i = 0; i < data.materials.size(); ++i)
         {
             MaterialParseInfo& material_info = data.materials.at(i);
             id_to_materialIdx[material_info.material_id] = i;
             
-            Material gl_material;
-            gl_material.albedo = material_info.diffuse;
-
+            ModelData::Material material;
+            material.albedo = material_info.diffuse;
             for(int j = 0; j < material_info.textureIDs.size(); ++j)
             {
                 int tid = material_info.textureIDs.at(j);
-                auto texture_info = data.textures.at(tid);
-                
-                auto gl_texture = TextureLoader::load(texture_info.fileName);
-                auto gl_texturetype = find_texture_type(texture_info.property);
-                gl_material.set_texture(gl_texturetype, gl_texture);
+                const auto& texture_info = data.textures.at(tid);
+                material.textures.push_back({(int)find_texture_type(texture_info.property), texture_info.fileName});
             }
-
-            gl_materials.push_back(gl_material);
+            mesh.materials.push_back(material);
         }
 
         // set vertex material connection
-
         for(int i = 0; i < data.polygonMaterialConnection.size(); i ++)
         {   
             int mid  = data.polygonMaterialConnection.at(i);
@@ -142,21 +134,82 @@ std::vector<std::pair<core::spMeshGL, vMaterial>> FBX::meshGLs()
             int idx1 = data.indices.at(i * 3 + 1);
             int idx2 = data.indices.at(i * 3 + 2);
 
-            mesh_gl->vertices.at(idx0).material_id = glm::vec3(mid, mid, mid);
-            mesh_gl->vertices.at(idx1).material_id = glm::vec3(mid, mid, mid);
-            mesh_gl->vertices.at(idx2).material_id = glm::vec3(mid, mid, mid);
+            mesh.vertices.at(idx0).material_id = glm::vec3(mid, mid, mid);
+            mesh.vertices.at(idx1).material_id = glm::vec3(mid, mid, mid);
+            mesh.vertices.at(idx2).material_id = glm::vec3(mid, mid, mid);
         }
-#if 0
-        mesh->materials = gl_materials;
-        
-        // material이 없을 경우, 기본 material로 setting
-        if(mesh->materials.size() == 0)
-            mesh->materials.push_back(Material());
-#endif
 
-#endif
+        // the parser emits 3 vertices per triangle. share the identical ones so that the vertex shader (skinning) runs once per vertex
+        mesh.indices = data.indices;
+        a::gl::core::weld_vertices(mesh.vertices, mesh.indices);
+        // then reorder triangles for the post-transform cache and overdraw, and vertices for fetch locality
+        a::gl::core::optimize_mesh(mesh.vertices, mesh.indices, AGL_OVERDRAW_THRESHOLD, AGL_VERTEX_CACHE_SIZE);
+
+        model.meshes.push_back(std::move(mesh));
+    }
+    return model;
+}
+
+FBX::FBX(std::string path, float scale)
+{
+    m_parser = std::make_unique<FBX::Parser>(path, scale);
+    m_scale = scale;
+
+    std::string cache = model_cache::path(path, scale);
+    if(cache.empty() == false && model_cache::load(cache, path, scale, m_parser->model))
+        return;
+
+    m_parser->model = parse_model(m_parser->fbx(), scale);
+    if(cache.empty() == false)
+        model_cache::save(cache, path, scale, m_parser->model);
+}
+
+FBX::~FBX()
+{}
+
+std::vector<std::pair<core::spMeshGL, vMaterial>> FBX::meshGLs()
+{
+    const auto& meshData = m_parser->model.meshes;
+    
+    std::vector<std::pair<core::spMeshGL, vMaterial>> results;
+    int n = meshData.size();
+    results.reserve(n);
+
+    for(const auto& data : meshData)
+    {
+        auto mesh_gl = std::make_shared<core::MeshGL>();
+        mesh_gl->is_skinned = data.is_skinned;
+        mesh_gl->vertices = data.vertices;
         mesh_gl->indices = data.indices;
+        if(data.is_skinned)
+        {
+            mesh_gl->joint_order = data.joint_order;
+            mesh_gl->name_to_idx = data.name_to_idx;
+            mesh_gl->jonit_bind_trf_inv = data.joint_bind_trf_inv;
+        }
+
+        // set materials and texture
+        std::vector<Material> gl_materials;
+        for(const auto& material : data.materials)
+        {
+            Material gl_material;
+            gl_material.albedo = material.albedo;
+            for(const auto& texture : material.textures)
+            {
+                auto gl_texture = TextureLoader::load(texture.second);
+                auto gl_texturetype = (TextureType)texture.first;
+                gl_material.set_texture(gl_texturetype, gl_texture);
+            }
+            gl_materials.push_back(gl_material);
+        }
+
+#if AGL_PACKED_VERTICES
+        mesh_gl->vao = a::gl::core::bind_packed_mesh(mesh_gl->vertices, mesh_gl->indices);
+#else
         mesh_gl->vao = a::gl::core::bind_mesh(mesh_gl->vertices, mesh_gl->indices);
+#endif
+        if(mesh_gl->is_skinned)
+            mesh_gl->skin_radius = a::gl::core::compute_skin_radius(mesh_gl->vertices, mesh_gl->jonit_bind_trf_inv);
         
         results.push_back(
             {mesh_gl, gl_materials}
@@ -169,17 +222,12 @@ std::vector<spJoint> FBX::joints()
 {
     std::vector<spJoint> joints;
 
-    // get data
-    //CharacterData data;
-    //m_parser->character_data(data, m_scale);
-    auto& charData = m_parser->charData;
-
     // generate objects
-    std::vector<JointData>& jnts = charData.joint_data;
+    const auto& jnts = m_parser->model.joints;
     std::vector<int> parent_idxes;
     for(int i = 0; i < jnts.size(); ++i)
     {
-        JointData& jnt = jnts.at(i);
+        const auto& jnt = jnts.at(i);
         auto obj = std::make_shared<Joint>();
         obj->set_name(jnt.name);
         obj->set_local_rot(to_eigen(jnt.local_R));
@@ -243,78 +291,157 @@ spModel FBX::model()
     return nullptr;
 }
 
-std::vector<Motion> FBX::motion(spModel model)
+std::vector<Motion> FBX::motion(spModel model, float fps)
 {
-    return this->motion(model->joints());
+    return this->motion(model->joints(), fps);
 }
 
-std::vector<Motion> FBX::motion(const std::vector<spJoint>& jnts)
+/**
+ * @brief clips of all the scenes of the parser. 
+ */
+static std::vector<MotionClip> scene_clips(FBXParser& parser, const std::vector<spJoint>& jnts, float scale)
 {
-    namespace keyframe = ::a::gl::keyframe;
-    auto& parser = m_parser->parser;
-
     // original scenes
     std::vector<spSceneKeyFrames> scenes;
-    parser.keyframes(scenes, m_scale);
-
-    // resampled scenes
-    std::vector<spSceneKeyFrames> resampled_scenes;
-    resampled_scenes.reserve(scenes.size());
-
-    // timesteps
-    std::vector<std::vector<float>> timestep_set;
-    timestep_set.reserve(scenes.size());
+    parser.keyframes(scenes, scale);
 
     std::vector<std::string> names;
-    int noj = jnts.size();
-    names.reserve(noj);
-    for(int i = 0; i < noj; ++i)
-    {
-        names.push_back(jnts.at(i)->name());
-    }
+    names.reserve(jnts.size());
+    for(const auto& jnt : jnts)
+        names.push_back(jnt->name());
+
+    std::vector<MotionClip> clips;
+    clips.reserve(scenes.size());
+    for(const auto& scene : scenes)
+        clips.emplace_back(scene, names);
+    return clips;
+}
 
-    static float dt = 1.0 / 60.0;
-    for(auto scene : scenes)
+/**
+ * @brief resampled motions of all the clips
+ * @param parallel scenes and joints in parallel (JobSystem). false: on the calling thread only
+ */
+static std::vector<Motion> clip_motions(const std::vector<MotionClip>& clips, float fps, bool parallel = true)
+{
+    std::vector<Motion> m_set(clips.size());
+    if(parallel == false)
     {
-        //std::cout << scene->name << ": " << scene->start_time << " ~ " << scene->end_time << std::endl;
-        std::vector<float> timestep = get_timestep(scene->start_time, scene->end_time, dt);
-        timestep_set.push_back(timestep);
-        resampled_scenes.push_back(keyframe::resample(scene, timestep));
+        for(int i = 0; i < (int)clips.size(); ++i)
+            m_set[i] = clips[i].motion(fps, false);
+        return m_set;
     }
 
-    std::vector<Motion> m_set;
-    m_set.reserve(resampled_scenes.size());
-    std::string root_name = jnts.at(0)->name();
-    for(int i = 0; i < resampled_scenes.size(); ++i)
+    JobSystem::parallel_for((int)clips.size(), [&](int i){
+        m_set[i] = clips[i].motion(fps);
+    });
+    return m_set;
+}
+
+std::vector<Motion> FBX::motion(const std::vector<spJoint>& jnts, float fps)
+{
+    return clip_motions(this->clips(jnts), fps);
+}
+
+std::vector<MotionClip> FBX::clips(const std::vector<spJoint>& jnts)
+{
+    return scene_clips(m_parser->fbx(), jnts, m_scale);
+}
+
+std::vector<MotionClip> FBX::clips(spModel model)
+{
+    return this->clips(model->joints());
+}
+
+std::vector<MotionImport> FBX::import_motions(const std::vector<std::string>& paths,
+                                              const std::vector<spJoint>& jnts,
+                                              float scale,
+                                              ImportProgress progress,
+                                              int threads,
+                                              float fps)
+{
+    int total = (int)paths.size();
+    std::vector<MotionImport> results(total);
+    if(total == 0)
+        return results;
+
+    if(threads <= 0)
+        threads = std::max(1, (int)std::thread::hardware_concurrency());
+    threads = std::min(threads, total);
+
+    std::atomic<int> next(0);
+    int done = 0;
+    std::mutex progress_mutex;
+    std::exception_ptr progress_error;
+
+    auto worker = [&]()
     {
-        auto scene = resampled_scenes.at(i);
-        int nof = timestep_set.at(i).size();
-        auto rotations_set = keyframe::get_rotations_from_resampled(names, scene, nof);
-
-        Motion m;
-        m.name = scene->name;
-        m.poses.resize(nof);
-        m.start_time = scene->start_time;
-        m.end_time = scene->end_time;
-        
-        auto positions = keyframe::get_translations_from_resampled(root_name, scene);
-        for(int i = 0; i < nof; ++i)
+        // one manager per worker. FbxManager is not thread safe, but separate managers are independent
+        ::fbxsdk::FbxManager* manager = ::fbxsdk::FbxManager::Create();
+
+        for(int i = next++; i < total; i = next++)
         {
-            Pose& p = m.poses.at(i);
-            
-            p.root_position = (positions.size() > i) ? to_eigen(positions.at(i)) : Vec3::Zero();
-            p.local_rotations.reserve(noj);
-            for(int j = 0; j < noj; ++j)
+            MotionImport& result = results[i];
+            result.path = paths[i];
+            auto begin = std::chrono::steady_clock::now();
+            try
+            {
+                FBXParser parser(paths[i], manager);
+                // the workers already use the cores. resampling on the JobSystem would oversubscribe them
+                if(parser.loaded())
+                    result.motions = clip_motions(scene_clips(parser, jnts, scale), fps, false);
+                else
+                    result.error = "failed to import " + paths[i];
+            }
+            catch(const std::exception& e)
             {
-                p.local_rotations.push_back(
-                    to_eigen(rotations_set.at(j).at(i))
-                );
+                result.motions.clear();
+                result.error = e.what();
+            }
+            result.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+
+            std::lock_guard<std::mutex> lock(progress_mutex);
+            done++;
+            if(progress && progress_error == nullptr)
+            {
+                // a throwing callback stops the import. rethrown on the caller after the workers finish
+                try
+                {
+                    progress(result, done, total);
+                }
+                catch(...)
+                {
+                    progress_error = std::current_exception();
+                    next = total;
+                }
             }
         }
 
-        m_set.push_back(m);
+        manager->Destroy();
+    };
+
+    std::vector<std::thread> workers;
+    for(int t = 1; t < threads; ++t)
+        workers.emplace_back(worker);
+    worker();
+    for(auto& w : workers)
+        w.join();
+
+    if(progress_error)
+        std::rethrow_exception(progress_error);
+    return results;
+}
+
+std::vector<Motion> FBX::motions(const std::vector<std::string>& paths, spModel model, float scale, ImportProgress progress, float fps)
+{
+    std::vector<Motion> motions;
+    for(auto& file : FBX::import_motions(paths, model->joints(), scale, progress, 0, fps))
+    {
+        if(file.ok() == false)
+            std::cerr << "FBX::motions: " << file.error << std::endl;
+        for(auto& m : file.motions)
+            motions.push_back(std::move(m));
     }
-    return m_set;
+    return motions;
 }
 
 }
\ No newline at end of file
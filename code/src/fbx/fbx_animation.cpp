@@ -1,4 +1,5 @@
 #include "fbxparser.h"
+#include <algorithm>
 #include <iostream>
 
 namespace a::gl {
@@ -10,7 +11,7 @@ using FbxProperty  = ::FbxProperty;
 using FbxAnimLayer = ::FbxAnimLayer;
 using FbxScene     = ::FbxScene;
 
-static spSceneKeyFrames getSceneAnimation(FbxAnimStack* pAnimStack, FbxNode* pNode, float scale);
+static spSceneKeyFrames getSceneAnimation(FbxAnimStack* pAnimStack, FbxNode* pNode, float scale, float frame_rate);
 static void getAnimations(spSceneKeyFrames scene_keyframes, FbxAnimLayer* pAnimLayer, FbxNode* pNode, float scale);
 static spNodeKeyFrames getKeyFrameAnimation(FbxNode* pNode, FbxAnimLayer* pAnimLayer, float scale);
 static std::vector<KeyFrame> getKeyFrames(FbxAnimCurve* pCurve, float scale, bool debug = false);
@@ -20,18 +21,21 @@ void FBXParser::keyframes(std::vector<spSceneKeyFrames>& data, float scale)
     data.clear();
     FbxScene* pScene = m_scene;
 
+    // frame rate of the file. FbxTime's global time mode is fixed to 60 fps by FBXParser
+    float frame_rate = (float)::fbxsdk::FbxTime::GetFrameRate(pScene->GetGlobalSettings().GetTimeMode());
+
     int n = pScene->GetSrcObjectCount<FbxAnimStack>();
     data.reserve(n);
     for (int i = 0; i < n; i++)
     {
         FbxAnimStack* lAnimStack = pScene->GetSrcObject<FbxAnimStack>(i);
         
-        auto skf = getSceneAnimation(lAnimStack, pScene->GetRootNode(), scale);
+        auto skf = getSceneAnimation(lAnimStack, pScene->GetRootNode(), scale, frame_rate);
         data.push_back(skf);
     }
 }
 
-spSceneKeyFrames getSceneAnimation(FbxAnimStack* pAnimStack, FbxNode* pNode, float scale)
+spSceneKeyFrames getSceneAnimation(FbxAnimStack* pAnimStack, FbxNode* pNode, float scale, float frame_rate)
 {
     int nbAnimLayers = pAnimStack->GetMemberCount<::FbxAnimLayer>();
     
@@ -50,16 +54,11 @@ spSceneKeyFrames getSceneAnimation(FbxAnimStack* pAnimStack, FbxNode* pNode, flo
         getAnimations(scene_keyframes, lAnimLayer, pNode, scale);
     }
     
-    char lTimeString[256];    
-    pAnimStack->LocalStart.Get().GetTimeString(lTimeString, FbxUShort(256));
-    float startFrame = std::atof(lTimeString);
-    pAnimStack->LocalStop.Get().GetTimeString(lTimeString, FbxUShort(256));
-    float endFrame = std::atof(lTimeString);
-    
-    float dt = 1.0f / 60.0f;
-    //scene_keyframes->dt = dt;
-    scene_keyframes->start_time = dt * startFrame;
-    scene_keyframes->end_time = dt * endFrame;
+    // seconds directly. the time string is in frames of the global time mode, not of the file
+    scene_keyframes->start_time = (float)pAnimStack->LocalStart.Get().GetSecondDouble();
+    scene_keyframes->end_time = (float)pAnimStack->LocalStop.Get().GetSecondDouble();
+    if(frame_rate > 0.0f)
+        scene_keyframes->frame_rate = frame_rate;
     return scene_keyframes;
 }
 
@@ -182,8 +181,32 @@ static ::a::gl::KeyInterpType getInterpolationType(int flags)
     return KeyInterpType::kUnknown;
 }
 
+/**
+ * @brief Kochanek-Bartels tangents of key k in value / sec. 이웃 key 가 없으면 있는 쪽의 기울기를 사용.
+ */
+static void getTCBSlopes(const std::vector<KeyFrame>& keys, int k, float tension, float continuity, float bias,
+                         float& left, float& right)
+{
+    int n = keys.size();
+    float d_prev = 0.0f, d_next = 0.0f;
+    if(k > 0)
+        d_prev = (keys[k].value - keys[k - 1].value) / std::max(keys[k].time - keys[k - 1].time, 1e-6f);
+    if(k + 1 < n)
+        d_next = (keys[k + 1].value - keys[k].value) / std::max(keys[k + 1].time - keys[k].time, 1e-6f);
+    if(k == 0)
+        d_prev = d_next;
+    if(k + 1 == n)
+        d_next = d_prev;
+
+    float t = 1.0f - tension;
+    left  = 0.5f * t * ((1.0f - continuity) * (1.0f + bias) * d_prev + (1.0f + continuity) * (1.0f - bias) * d_next);
+    right = 0.5f * t * ((1.0f + continuity) * (1.0f + bias) * d_prev + (1.0f - continuity) * (1.0f - bias) * d_next);
+}
+
 std::vector<KeyFrame> getKeyFrames(FbxAnimCurve* pCurve, float scale, bool debug)
 {
+    using FbxAnimCurveDef = ::FbxAnimCurveDef;
+
     std::vector<KeyFrame> keys;
     if(pCurve == nullptr)
         return keys;
@@ -199,9 +222,27 @@ std::vector<KeyFrame> getKeyFrames(FbxAnimCurve* pCurve, float scale, bool debug
         ::fbxsdk::FbxTime lKeyTime = pCurve->KeyGetTime(lCount);
         key.time = (float)lKeyTime.GetSecondDouble();
         key.type = getInterpolationType(pCurve->KeyGetInterpolation(lCount));
+
+        // user, auto and break tangents. the SDK evaluates them as derivatives per second
+        key.left_slope  = scale * pCurve->KeyGetLeftDerivative(lCount);
+        key.right_slope = scale * pCurve->KeyGetRightDerivative(lCount);
         keys.push_back(key);
     }
 
+    // TCB tangents depend on the neighbor keys
+    for(int lCount = 0; lCount < lKeyCount; lCount++)
+    {
+        if((pCurve->KeyGetTangentMode(lCount) & FbxAnimCurveDef::eTangentTCB) != FbxAnimCurveDef::eTangentTCB)
+            continue;
+
+        ::FbxAnimCurveKey lKey = pCurve->KeyGet(lCount);
+        getTCBSlopes(keys, lCount,
+                     lKey.GetDataFloat(FbxAnimCurveDef::eTCBTension),
+                     lKey.GetDataFloat(FbxAnimCurveDef::eTCBContinuity),
+                     lKey.GetDataFloat(FbxAnimCurveDef::eTCBBias),
+                     keys[lCount].left_slope, keys[lCount].right_slope);
+    }
+
     return keys;
 }
 
@@ -1,6 +1,7 @@
 #include "fbxparser.h"
 #include <iostream>
 #include <assert.h>
+#include <mutex>
 
 namespace a::gl {
 
@@ -36,16 +37,25 @@ static void checkSameName(FbxNode* pNode, std::map<std::string, int>& counter)
     }
 }
 
-FBXParser::FBXParser(std::string filepath)
+FBXParser::FBXParser(std::string filepath, ::fbxsdk::FbxManager* manager)
 {
-    std::cout << "fbx file import: " << filepath << std::endl;
+    // FBX::import_motions parses files on several threads. one line per file
+    {
+        static std::mutex log_mutex;
+        std::lock_guard<std::mutex> lock(log_mutex);
+        std::cout << "fbx file import: " << filepath << std::endl;
+    }
 
     // Initialize the SDK manager. This object handles memory management.
-    m_manager = ::fbxsdk::FbxManager::Create();
+    m_owns_manager = (manager == nullptr);
+    m_manager = m_owns_manager ? ::fbxsdk::FbxManager::Create() : manager;
 
     // Create the IO settings object.
-    ::fbxsdk::FbxIOSettings *ios = ::fbxsdk::FbxIOSettings::Create(m_manager, IOSROOT);
-    m_manager->SetIOSettings(ios);
+    if(m_manager->GetIOSettings() == nullptr)
+    {
+        ::fbxsdk::FbxIOSettings *ios = ::fbxsdk::FbxIOSettings::Create(m_manager, IOSROOT);
+        m_manager->SetIOSettings(ios);
+    }
 
     // Create an importer using the SDK manager.
     FbxImporter* importer = FbxImporter::Create(m_manager, "");
@@ -56,6 +66,7 @@ FBXParser::FBXParser(std::string filepath)
     if(!success)
     {
         std::cerr << __FILE__ << "(line " << __LINE__ << ")" << importer->GetStatus().GetErrorString() << std::endl;
+        importer->Destroy();
         clear();
         return;
     }
@@ -64,12 +75,19 @@ FBXParser::FBXParser(std::string filepath)
     m_scene = FbxScene::Create(m_manager, "scene");
 
     // Import the contents of the file into the scene.
-    importer->Import(m_scene);
+    if(importer->Import(m_scene) == false)
+    {
+        std::cerr << __FILE__ << "(line " << __LINE__ << ")" << importer->GetStatus().GetErrorString() << std::endl;
+        importer->Destroy();
+        clear();
+        return;
+    }
 
-    // time setting (60 fps)
-    ::fbxsdk::FbxGlobalSettings* lTimeSettings = &m_scene->GetGlobalSettings();
-    ::fbxsdk::FbxTime::EMode lTimeMode = lTimeSettings->GetTimeMode();
-    ::fbxsdk::FbxTime::SetGlobalTimeMode(::fbxsdk::FbxTime::EMode::eFrames60);
+    // time setting (60 fps). process-wide, so set only once when several threads import at the same time
+    static std::once_flag time_mode_flag;
+    std::call_once(time_mode_flag, []{
+        ::fbxsdk::FbxTime::SetGlobalTimeMode(::fbxsdk::FbxTime::EMode::eFrames60);
+    });
 
     // axis setting
     ::fbxsdk::FbxAxisSystem sceneAxisSystem = m_scene->GetGlobalSettings().GetAxisSystem();
@@ -97,11 +115,17 @@ FBXParser::FBXParser(std::string filepath)
 void FBXParser::clear()
 {
     // Destroy the SDK manager and all the other objects it was handling.
-    if(m_manager)
+    if(m_manager && m_owns_manager)
     {
         m_manager->Destroy();
-        m_manager = nullptr;
     }
+    else if(m_scene)
+    {
+        // shared manager: only the scene of this file
+        m_scene->Destroy();
+    }
+    m_manager = nullptr;
+    m_scene = nullptr;
 }
 
 void bakeNode(FbxNode* pNode)
@@ -23,9 +23,18 @@ struct SkinningData;
 class FBXParser
 {
 public:
-    explicit FBXParser(std::string path);
+    /**
+     * @param manager shared manager of the calling thread (batch import). nullptr: own manager.
+     *                manager 는 한 thread 에서만 사용해야 함.
+     */
+    explicit FBXParser(std::string path, ::fbxsdk::FbxManager* manager = nullptr);
 
     ~FBXParser() { clear(); }
+
+    /**
+     * @return false if the file couldn't be imported
+     */
+    bool loaded() const { return m_scene != nullptr; }
     
     void mesh_data(std::vector<MeshData>&, float scale);
 
@@ -36,9 +45,11 @@ public:
 private:
     void clear();
 
-    ::fbxsdk::FbxManager* m_manager;
+    ::fbxsdk::FbxManager* m_manager{nullptr};
     
-    ::fbxsdk::FbxScene*   m_scene;
+    ::fbxsdk::FbxScene*   m_scene{nullptr};
+
+    bool                  m_owns_manager{true};
 };
 
 /**
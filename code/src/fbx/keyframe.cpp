@@ -1,10 +1,24 @@
 #include "keyframe.h"
+#include "aOpenGL/jobs.h"
+#include <algorithm>
+#include <cassert>
 #include <cmath>
+#include <limits>
 #include <iostream>
 #include <glm/gtx/quaternion.hpp>
 
 namespace a::gl {
 
+int SampledScene::find(const std::string& node_name) const
+{
+    for(int i = 0; i < (int)node_names.size(); ++i)
+    {
+        if(node_names[i] == node_name)
+            return i;
+    }
+    return -1;
+}
+
 namespace keyframe {
 
 static bool is_equal_time(float t0, float t1)
@@ -16,51 +30,136 @@ static bool is_equal_time(float t0, float t1)
 }
 
 /**
- * @return target_time 보다 크지 않은 최대 frame의 index를 리턴.
+ * @brief monotonic cursor over the keys of one channel
  */
-static int search_key(const std::vector<KeyFrame>& frames, float target_time, int iter_idx, bool upper_checked)
+struct KeyCursor
 {
-    if(iter_idx >= (int)frames.size())
-        return frames.size() - 1;
-    if(iter_idx < 0)
-        return 0;
+    const std::vector<KeyFrame>& frames;
+    int lower{0};
 
-    float iter_time = frames.at(iter_idx).time;
-    
-    if(is_equal_time(iter_time, target_time))
+    explicit KeyCursor(const std::vector<KeyFrame>& frames) : frames(frames) {}
+
+    /**
+     * @return target_time 보다 크지 않은 최대 frame의 index (is_equal_time 이면 그 frame).
+     *         target_time 이 증가하면 cursor 에서 galloping search, 감소하면 전체 binary search.
+     */
+    int seek(float target_time)
     {
-        return iter_idx;
+        int n = (int)frames.size();
+        float t = target_time + 0.0001f; // is_equal_time
+
+        int lo, hi; // answer in [lo, hi)
+        if(frames[lower].time > t)
+        {
+            lo = 0;
+            hi = lower;
+        }
+        else
+        {
+            // gallop: 1, 2, 4, ... keys ahead
+            int step = 1;
+            lo = lower;
+            hi = lower + 1;
+            while(hi < n && frames[hi].time <= t)
+            {
+                lo = hi;
+                step <<= 1;
+                hi = std::min(n, lo + step);
+            }
+        }
+
+        // last index in [lo, hi) with time <= t
+        while(hi - lo > 1)
+        {
+            int mid = lo + (hi - lo) / 2;
+            if(frames[mid].time <= t)
+                lo = mid;
+            else
+                hi = mid;
+        }
+        lower = lo;
+        return lower;
     }
-    else if (iter_time > target_time)
+};
+
+/**
+ * @brief segment [frames[k], frames[k + 1]] as a cubic in s = (t - t0) / (t1 - t0), s in [0, 1]
+ */
+struct KeySegment
+{
+    float t0{0.0f};
+    float inv_dt{0.0f};
+    float c[4]{0.0f, 0.0f, 0.0f, 0.0f};
+
+    KeySegment(const std::vector<KeyFrame>& frames, int k)
     {
-        return search_key(frames, target_time, iter_idx - 1, true);
+        const KeyFrame& k0 = frames[k];
+        c[0] = k0.value;
+        t0 = k0.time;
+        if(k + 1 >= (int)frames.size())
+            return;
+
+        const KeyFrame& k1 = frames[k + 1];
+        float dt = k1.time - k0.time;
+        if(is_equal_time(k0.time, k1.time) || k0.type == KeyInterpType::kConstant)
+            return;
+
+        inv_dt = 1.0f / dt;
+        if(k0.type == KeyInterpType::kCubic)
+        {
+            // Hermite: p0, m0, p1, m1 with the tangents scaled to the segment
+            float p0 = k0.value, p1 = k1.value;
+            float m0 = k0.right_slope * dt, m1 = k1.left_slope * dt;
+            c[1] = m0;
+            c[2] = -3.0f * p0 - 2.0f * m0 + 3.0f * p1 - m1;
+            c[3] =  2.0f * p0 + m0 - 2.0f * p1 + m1;
+        }
+        else
+        {
+            c[1] = k1.value - k0.value;
+        }
     }
-    else
+
+    /**
+     * @brief branch free so that the loop can be vectorized
+     */
+    void evaluate(const float* timestep, int n, float* out) const
     {
-        if(upper_checked)
+        const float c0 = c[0], c1 = c[1], c2 = c[2], c3 = c[3];
+        for(int i = 0; i < n; ++i)
         {
-            return iter_idx;
+            float s = std::min(1.0f, std::max(0.0f, (timestep[i] - t0) * inv_dt));
+            out[i] = c0 + s * (c1 + s * (c2 + s * c3));
         }
-        else
-            return search_key(frames, target_time, iter_idx + 1, false);
-    }    
-}
+    }
+};
 
-static float interpolate_linear(float v0, float v1, float t, float t0, float t1)
+void sample(const std::vector<KeyFrame>& frames, const float* timestep, int n, float* out)
 {
-    if(is_equal_time(t0, t1))
-        return v0;
-    else if(t >= t1)
-        return v1;
-    else if(t <= t0)
-        return v0;
-    
-    float w0 = (t1 - t) / (t1 - t0);   
-    return w0 * v0 + (1.0 - w0) * v1;
-}
+    if(frames.size() == 0)
+    {
+        std::fill(out, out + n, 0.0f);
+        return;
+    }
 
-#if 0
-#else
+    int max_idx = frames.size() - 1;
+    KeyCursor cursor(frames);
+    int i = 0;
+    while(i < n)
+    {
+        int k = cursor.seek(timestep[i]);
+
+        // following samples that the cursor would put in the same segment
+        float lower = (k == 0)       ? -std::numeric_limits<float>::infinity() : frames[k].time;
+        float upper = (k == max_idx) ?  std::numeric_limits<float>::infinity() : frames[k + 1].time;
+        int j = i + 1;
+        while(j < n && timestep[j] + 0.0001f >= lower && timestep[j] + 0.0001f < upper)
+            ++j;
+
+        KeySegment(frames, k).evaluate(timestep + i, j - i, out + i);
+        i = j;
+    }
+}
 
 std::vector<KeyFrame> resample(const std::vector<KeyFrame>& frames, const std::vector<float>& timestep)
 {
@@ -69,46 +168,19 @@ std::vector<KeyFrame> resample(const std::vector<KeyFrame>& frames, const std::v
     {
         return new_keys;
     }
-    new_keys.reserve(timestep.size());    
-    
-    int max_idx = frames.size() - 1;
 
-    int lower_idx = 0;
-    for(int i = 0; i < (int)timestep.size(); ++i)
+    int n = timestep.size();
+    std::vector<float> values(n);
+    sample(frames, timestep.data(), n, values.data());
+
+    new_keys.resize(n);
+    KeyCursor cursor(frames);
+    for(int i = 0; i < n; ++i)
     {
-        float ti = timestep.at(i);
-        lower_idx = search_key(frames, ti, lower_idx, false);
-        int upper_idx = std::min(lower_idx + 1, max_idx);
-        
-        // if(i == 5)
-        // {
-        //     if(frames.at(upper_idx).type == KeyInterpType::kLinear)
-        //         std::cout << "linear" << std::endl;
-        //     else if (frames.at(upper_idx).type == KeyInterpType::kUnknown)
-        //         std::cout << "unknown" << std::endl;
-        //     else if (frames.at(upper_idx).type == KeyInterpType::kConstant)
-        //         std::cout << "constant" << std::endl;
-        //     else if (frames.at(upper_idx).type == KeyInterpType::kCubic)
-        //         std::cout << "cubic" << std::endl;
-        // }
-        
-        //assert(frames.at(upper_idx).type == KeyInterpType::kLinear);
-        //assert(frames.at(lower_idx).type == KeyInterpType::kLinear);
-
-        // TODO: other interpolation type
-        float v_t = interpolate_linear(frames.at(lower_idx).value,
-                                       frames.at(upper_idx).value,
-                                       ti,
-                                       frames.at(lower_idx).time,
-                                       frames.at(upper_idx).time);
-
-        KeyFrame new_key;
-        new_key.time = ti;
-        new_key.value = v_t;
-        new_key.type = frames.at(lower_idx).type;
-        new_keys.push_back(new_key);
+        new_keys[i].time = timestep[i];
+        new_keys[i].value = values[i];
+        new_keys[i].type = frames[cursor.seek(timestep[i])].type;
     }
-    
     return new_keys;
 }
 
@@ -139,65 +211,195 @@ spSceneKeyFrames resample(spSceneKeyFrames scene, const std::vector<float>& time
     resampled->name       = scene->name;
     
     int n = scene->node_keyframes.size();
-    resampled->node_keyframes.reserve(n);
-    
+    resampled->node_keyframes.resize(n);
+
+    JobSystem::parallel_for(n, [&](int i){
+        resampled->node_keyframes[i] = ::a::gl::keyframe::resample(scene->node_keyframes[i], timestep);
+    });
+    return resampled;
+}
+
+/**
+ * @brief allocate the buffer of the scene. channels are sampled by sample_node()
+ */
+static SampledScene prepare(const spSceneKeyFrames& scene, int nof)
+{
+    SampledScene sampled;
+    sampled.name       = scene->name;
+    sampled.start_time = scene->start_time;
+    sampled.end_time   = scene->end_time;
+    sampled.frame_num  = nof;
+
+    int n = scene->node_keyframes.size();
+    sampled.node_names.reserve(n);
+    sampled.euler_orders.reserve(n);
+    sampled.has_keys.resize((size_t)n * SampledScene::kChannelNum);
     for(int i = 0; i < n; ++i)
     {
-        spNodeKeyFrames keys = ::a::gl::keyframe::resample(scene->node_keyframes.at(i), timestep);
-        resampled->node_keyframes.push_back(keys);
+        const auto& node = scene->node_keyframes[i];
+        sampled.node_names.push_back(node->name);
+        sampled.euler_orders.push_back(node->euler_order);
+        for(int k = 0; k < 3; ++k)
+        {
+            sampled.has_keys[i * SampledScene::kChannelNum + SampledScene::kEulerX + k] = node->euler[k].empty() ? 0 : 1;
+            sampled.has_keys[i * SampledScene::kChannelNum + SampledScene::kPosX + k]   = node->pos[k].empty() ? 0 : 1;
+            sampled.has_keys[i * SampledScene::kChannelNum + SampledScene::kScaleX + k] = node->scale[k].empty() ? 0 : 1;
+        }
+    }
+    sampled.values.resize((size_t)n * SampledScene::kChannelNum * nof);
+    return sampled;
+}
+
+static void sample_node(const NodeKeyFrames& node, const std::vector<float>& timestep, SampledScene& sampled, int idx)
+{
+    int nof = sampled.frame_num;
+    for(int k = 0; k < 3; ++k)
+    {
+        sample(node.euler[k], timestep.data(), nof, sampled.channel(idx, SampledScene::kEulerX + k));
+        sample(node.pos[k],   timestep.data(), nof, sampled.channel(idx, SampledScene::kPosX + k));
+        sample(node.scale[k], timestep.data(), nof, sampled.channel(idx, SampledScene::kScaleX + k));
     }
-    return resampled;
 }
 
-#endif
+SampledScene sample(const spSceneKeyFrames& scene, const std::vector<float>& timestep)
+{
+    SampledScene sampled = prepare(scene, timestep.size());
 
-std::vector<glm::quat> to_quaternions(const std::vector<float>& e0,
-                                      const std::vector<float>& e1,
-                                      const std::vector<float>& e2,
-                                      const std::vector<glm::vec3>& axes)
+    int n = scene->node_keyframes.size();
+    JobSystem::parallel_for(n, [&](int i){
+        sample_node(*scene->node_keyframes[i], timestep, sampled, i);
+    });
+    return sampled;
+}
+
+std::vector<SampledScene> sample(const std::vector<spSceneKeyFrames>& scenes, const std::vector<std::vector<float>>& timesteps)
 {
-    int n = e0.size();
-    std::vector<glm::quat> quats;
-    quats.reserve(n);
+    assert(scenes.size() == timesteps.size());
 
-    for(int i = 0; i < n; ++i)
+    // one flat job list of (scene, node) so that short scenes don't leave threads idle
+    std::vector<SampledScene> sampled;
+    std::vector<std::pair<int, int>> items;
+    sampled.reserve(scenes.size());
+    for(int s = 0; s < (int)scenes.size(); ++s)
     {
-        auto q0 = glm::angleAxis(e0.at(i), axes[0]);
-        auto q1 = glm::angleAxis(e1.at(i), axes[1]);
-        auto q2 = glm::angleAxis(e2.at(i), axes[2]);
-        glm::quat q = q2 * q1 * q0;
-        q = glm::normalize(q);
-        quats.push_back(q);
+        sampled.push_back(prepare(scenes[s], timesteps[s].size()));
+        for(int i = 0; i < (int)scenes[s]->node_keyframes.size(); ++i)
+            items.emplace_back(s, i);
     }
 
-    return quats;
+    JobSystem::parallel_for(items.size(), [&](int j){
+        int s = items[j].first, i = items[j].second;
+        sample_node(*scenes[s]->node_keyframes[i], timesteps[s], sampled[s], i);
+    });
+    return sampled;
 }
 
-#if 0
-#else
-
-static std::vector<float> get_radians(const std::vector<KeyFrame>& keys, int nof)
+/**
+ * @brief sin, cos of x (radians) without a libm call so that the loop can be vectorized.
+ *        quadrant 로 [-pi/4, pi/4] 까지 줄인 후 polynomial. error < 2e-7 for |x| < 1e5
+ */
+static inline void fast_sincos(float x, float& s, float& c)
 {
-    static float to_rad = M_PI / 180.0f;
-    std::vector<float> angles;
+    const float two_over_pi = 0.636619772f;
+    float fq = x * two_over_pi;
+    int q = (int)(fq + (fq >= 0.0f ? 0.5f : -0.5f));
+
+    // Cody-Waite: pi/2 = p0 + p1 + p2
+    float r = x - q * 1.5703125f;
+    r = r - q * 4.837512969970703125e-4f;
+    r = r - q * 7.549789954891882e-8f;
+    float r2 = r * r;
+
+    float sr = r + r * r2 * (-1.6666654611e-1f + r2 * (8.3321608736e-3f + r2 * -1.9515295891e-4f));
+    float cr = 1.0f - 0.5f * r2 + r2 * r2 * (4.166664568298827e-2f + r2 * (-1.388731625493765e-3f + r2 * 2.443315711809948e-5f));
+
+    // quadrant: 1 -> (cos, -sin), 2 -> (-sin, -cos), 3 -> (-cos, sin)
+    bool swap = (q & 1) != 0;
+    float ss = swap ? cr : sr;
+    float cc = swap ? sr : cr;
+    s = (q & 2)       ? -ss : ss;
+    c = ((q + 1) & 2) ? -cc : cc;
+}
 
-    if(keys.size() == 0)
+void euler_to_quat(const float* ex, const float* ey, const float* ez, glm::ivec3 order, int n,
+                   float* qw, float* qx, float* qy, float* qz)
+{
+    // q = qc * qb * qa, rotation about axis a is applied first.
+    // a single rotation has one vector component, so the product is closed form.
+    // parity p: e_a x e_b = p * e_c. +1 for xyz, yzx, zxy and -1 for xzy, yxz, zyx
+    const float half_rad = 0.5f * (float)M_PI / 180.0f;
+    const float* e[3] = { ex, ey, ez };
+    float*       v[3] = { qx, qy, qz };
+    const float* ea = e[order.x];
+    const float* eb = e[order.y];
+    const float* ec = e[order.z];
+    float* va = v[order.x];
+    float* vb = v[order.y];
+    float* vc = v[order.z];
+    const float p = ((order.y - order.x + 3) % 3 == 1) ? 1.0f : -1.0f;
+
+    // fixed size blocks on the stack: no aliasing with the caller's buffers (in place is fine)
+    // so that the compiler vectorizes the inner loop
+    const int kBlock = 64;
+    float a[kBlock], b[kBlock], c[kBlock];
+    float w[kBlock], x[kBlock], y[kBlock], z[kBlock];
+    for(int begin = 0; begin < n; begin += kBlock)
     {
-        angles.resize(nof, 0);
-        return angles;
+        int m = std::min(kBlock, n - begin);
+        for(int i = 0; i < m; ++i)
+        {
+            a[i] = half_rad * ea[begin + i];
+            b[i] = half_rad * eb[begin + i];
+            c[i] = half_rad * ec[begin + i];
+        }
+        for(int i = m; i < kBlock; ++i)
+            a[i] = b[i] = c[i] = 0.0f;
+
+        for(int i = 0; i < kBlock; ++i)
+        {
+            float sa, ca, sb, cb, sc, cc;
+            fast_sincos(a[i], sa, ca);
+            fast_sincos(b[i], sb, cb);
+            fast_sincos(c[i], sc, cc);
+
+            float cbca = cb * ca, sbsa = sb * sa;
+            float cbsa = cb * sa, sbca = sb * ca;
+            w[i] = cc * cbca + p * sc * sbsa;
+            x[i] = cc * cbsa - p * sc * sbca;
+            y[i] = cc * sbca + p * sc * cbsa;
+            z[i] = sc * cbca - p * cc * sbsa;
+        }
+
+        for(int i = 0; i < m; ++i)
+        {
+            qw[begin + i] = w[i];
+            va[begin + i] = x[i];
+            vb[begin + i] = y[i];
+            vc[begin + i] = z[i];
+        }
     }
-    else
+}
+
+void to_quaternions(const float* ex, const float* ey, const float* ez, glm::ivec3 order, int n, glm::quat* out)
+{
+    // SoA blocks on the stack, then interleave
+    const int kBlock = 256;
+    float qw[kBlock], qx[kBlock], qy[kBlock], qz[kBlock];
+    for(int begin = 0; begin < n; begin += kBlock)
     {
-        assert((int)keys.size() == nof);
-        angles.reserve(nof);
-        for(int i = 0; i < nof; ++i)
+        int m = std::min(kBlock, n - begin);
+        euler_to_quat(ex + begin, ey + begin, ez + begin, order, m, qw, qx, qy, qz);
+        for(int i = 0; i < m; ++i)
         {
-            angles.push_back(to_rad * keys.at(i).value);
+            // ! be careful with quat constructor order: w, x, y, z
+            out[begin + i] = glm::quat(qw[i], qx[i], qy[i], qz[i]);
         }
-        return angles;
     }
 }
 
+#if 0
+#else
+
 static std::vector<float> get_values(const std::vector<KeyFrame>& keys)
 {
     std::vector<float> values;
@@ -247,31 +449,18 @@ std::vector<std::vector<glm::quat>> get_rotations_from_resampled(const std::vect
             int idx = iter->second;
             spNodeKeyFrames node = scene->node_keyframes.at(idx);
             
-            glm::ivec3 order = node->euler_order;
-            
-            std::vector<float> e0 = get_radians(node->euler[order.x], nof);
-            std::vector<float> e1 = get_radians(node->euler[order.y], nof);
-            std::vector<float> e2 = get_radians(node->euler[order.z], nof);
-
-            // if(i == 0)
-            // {
-            //     printf("%d, %d, %d\n", order.x, order.y, order.z);
-            //     for(int k = 0; k < e0.size(); ++k)
-            //     {
-            //         printf("%d: %.3g, %.3g, %.3g\n", k, e0[k], e1[k], e2[k]);
-            //     }
-            //     printf("\n");
-            // }
-            
-            static const std::vector<glm::vec3> axes = {
-                glm::vec3(1, 0, 0), glm::vec3(0, 1, 0), glm::vec3(0, 0, 1)
-            };
-
-            std::vector<glm::vec3> e_axes = { 
-                axes[order.x], axes[order.y], axes[order.z]
-            };
-            
-            auto rotations = to_quaternions(e0, e1, e2, e_axes);
+            // channels without keys are 0
+            std::vector<float> euler((size_t)nof * 3, 0.0f);
+            for(int k = 0; k < 3; ++k)
+            {
+                const auto& keys = node->euler[k];
+                assert(keys.empty() || (int)keys.size() == nof);
+                for(int f = 0; f < (int)keys.size(); ++f)
+                    euler[(size_t)k * nof + f] = keys[f].value;
+            }
+
+            std::vector<glm::quat> rotations(nof);
+            to_quaternions(euler.data(), euler.data() + nof, euler.data() + 2 * nof, node->euler_order, nof, rotations.data());
             scene_animation.push_back(rotations);
         }
     }
@@ -330,5 +519,49 @@ std::vector<glm::vec3> get_translations_from_resampled(std::string name, spScene
     return translations;
 }
 
+std::vector<std::vector<glm::quat>> get_rotations(const SampledScene& scene, const std::vector<std::string>& names)
+{
+    int nof = scene.frame_num;
+    std::vector<std::vector<glm::quat>> scene_animation(names.size());
+    for(int i = 0; i < (int)names.size(); ++i)
+    {
+        int idx = scene.find(names[i]);
+        if(idx < 0)
+        {
+            // ! be careful with quat constructor order: w, x, y, z
+            scene_animation[i].assign(nof, glm::quat(1.0, 0.0, 0.0, 0.0));
+            std::cout << __FILE__ << "(" << __LINE__ << "): " << names[i] << " not found." << std::endl;
+            continue;
+        }
+
+        scene_animation[i].resize(nof);
+        to_quaternions(scene.channel(idx, SampledScene::kEulerX + 0),
+                       scene.channel(idx, SampledScene::kEulerX + 1),
+                       scene.channel(idx, SampledScene::kEulerX + 2),
+                       scene.euler_orders[idx], nof, scene_animation[i].data());
+    }
+    return scene_animation;
+}
+
+std::vector<glm::vec3> get_translations(const SampledScene& scene, const std::string& name)
+{
+    std::vector<glm::vec3> translations;
+    int idx = scene.find(name);
+    if(idx < 0)
+    {
+        std::cout << __FILE__ << "(" << __LINE__ << "): " << name << " not found." << std::endl;
+        return translations;
+    }
+
+    // channels without keys are sampled as 0
+    const float* x = scene.channel(idx, SampledScene::kPosX + 0);
+    const float* y = scene.channel(idx, SampledScene::kPosX + 1);
+    const float* z = scene.channel(idx, SampledScene::kPosX + 2);
+    translations.resize(scene.frame_num);
+    for(int f = 0; f < scene.frame_num; ++f)
+        translations[f] = glm::vec3(x[f], y[f], z[f]);
+    return translations;
+}
+
 }
 }
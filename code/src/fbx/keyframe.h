@@ -1,4 +1,5 @@
 #pragma once
+#include <string>
 #include <vector>
 #include <map>
 #include <memory>
@@ -8,19 +9,22 @@
 namespace a::gl {
 
 /**
- * @brief 
- * TODO: support interpolation types
+ * @brief interpolation from this key to the next one. kUnknown is sampled as kLinear.
  */
 enum class KeyInterpType { kUnknown, kConstant, kLinear, kCubic };
 
 /**
  * @brief key frame
+ *        left_slope, right_slope: derivative (value / sec) at the key, used by kCubic (Hermite).
+ *        FBX 의 user/auto/break tangent 와 TCB 는 import 할 때 slope 로 변환.
  */
 struct KeyFrame
 {
     float value{0.0};
     float time{0.0};
     KeyInterpType type{KeyInterpType::kUnknown};
+    float left_slope{0.0};
+    float right_slope{0.0};
 };
 
 /**
@@ -45,11 +49,80 @@ struct SceneKeyFrames
     std::vector<spNodeKeyFrames> node_keyframes;
     float start_time; // sec
     float end_time; // sec
+    float frame_rate{60.0f}; // frames per sec of the source file
 };
 using spSceneKeyFrames = std::shared_ptr<SceneKeyFrames>;
 
+/**
+ * @brief resampled channels of a scene in one SoA buffer: values[(node * kChannelNum + channel) * frame_num + frame]
+ *        channel: euler x, y, z (degrees), pos x, y, z, scale x, y, z
+ */
+struct SampledScene
+{
+    static constexpr int kChannelNum = 9;
+    enum Channel { kEulerX = 0, kPosX = 3, kScaleX = 6 };
+
+    std::string              name;
+    float                    start_time{0.0f};
+    float                    end_time{0.0f};
+    int                      frame_num{0};
+    std::vector<std::string> node_names;
+    std::vector<glm::ivec3>  euler_orders;
+    std::vector<float>       values;
+    std::vector<char>        has_keys;  // [node * kChannelNum + channel]. 0: no source keys (sampled as 0)
+
+    const float* channel(int node, int c) const { return values.data() + ((size_t)node * kChannelNum + c) * frame_num; }
+    float*       channel(int node, int c)       { return values.data() + ((size_t)node * kChannelNum + c) * frame_num; }
+    bool         has(int node, int c) const     { return has_keys[(size_t)node * kChannelNum + c] != 0; }
+
+    /**
+     * @return node index, -1 if not found
+     */
+    int find(const std::string& node_name) const;
+};
+
 namespace keyframe {
 
+/**
+ * @brief sample one channel at the timesteps into out[0, n). no allocation.
+ *        timestep 이 증가하는 동안은 cursor 에서 galloping search, 감소하면 binary search.
+ *        key 사이의 segment 는 cubic 으로 만들어 segment 에 속한 sample 들을 한번에 계산.
+ */
+void sample(const std::vector<KeyFrame>& frames, const float* timestep, int n, float* out);
+
+/**
+ * @brief sample all the channels of the scene. nodes are sampled in parallel (JobSystem)
+ */
+SampledScene sample(const spSceneKeyFrames& scene, const std::vector<float>& timestep);
+
+/**
+ * @brief sample several scenes. all the (scene, node) pairs are sampled in parallel
+ */
+std::vector<SampledScene> sample(const std::vector<spSceneKeyFrames>& scenes, const std::vector<std::vector<float>>& timesteps);
+
+/**
+ * @brief batched euler angles (degrees) of x, y, z channels to quaternions for all six orders. SoA in and out.
+ *        order.x 축 회전이 먼저 적용됨. closed form + polynomial sincos, branch free so the loop is vectorized.
+ *        in place 가능: qx, qy, qz 는 ex, ey, ez 와 같은 buffer 여도 됨.
+ */
+void euler_to_quat(const float* ex, const float* ey, const float* ez, glm::ivec3 order, int n,
+                   float* qw, float* qx, float* qy, float* qz);
+
+/**
+ * @brief euler_to_quat() into glm::quat. out[0, n)
+ */
+void to_quaternions(const float* ex, const float* ey, const float* ez, glm::ivec3 order, int n, glm::quat* out);
+
+/**
+ * @return rotations in names order. { names x frame_num }. identity for the names not in the scene
+ */
+std::vector<std::vector<glm::quat>> get_rotations(const SampledScene& scene, const std::vector<std::string>& names);
+
+/**
+ * @return translations of the node. empty if not found
+ */
+std::vector<glm::vec3> get_translations(const SampledScene& scene, const std::string& name);
+
 /**
  * @brief resample single channel
  */
@@ -0,0 +1,421 @@
+#include "modelcache.h"
+#include "aOpenGL/config.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+
+namespace a::gl {
+namespace model_cache {
+
+static const char     MAGIC[4] = {'A', 'G', 'L', 'M'};
+static const uint32_t VERSION  = 2; // increase when the layout or the import processing changes
+
+/**
+ * @brief whole file in memory. the blobs are copied into ModelData anyway, so a single read is enough.
+ */
+static bool read_file(const std::string& path, std::vector<char>& buffer)
+{
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if(!file)
+        return false;
+    std::streamoff size = file.tellg();
+    if(size <= 0)
+        return false;
+    buffer.resize((size_t)size);
+    file.seekg(0);
+    return (bool)file.read(buffer.data(), buffer.size());
+}
+
+/**
+ * @brief bounds checked reader over the file. ok() is false after reading past the end.
+ */
+class Reader
+{
+public:
+    Reader(const char* data, size_t size) : m_data(data), m_size(size) {}
+
+    bool ok() const { return m_ok; }
+
+    void bytes(void* out, size_t n)
+    {
+        if(m_ok == false || n > m_size - m_pos)
+        {
+            m_ok = false;
+            std::memset(out, 0, n);
+            return;
+        }
+        std::memcpy(out, m_data + m_pos, n);
+        m_pos += n;
+    }
+
+    template<typename T>
+    T get()
+    {
+        T value;
+        bytes(&value, sizeof(T));
+        return value;
+    }
+
+    /**
+     * @brief element count of a list. each element takes at least item_bytes in the file,
+     *        so a corrupted count fails here instead of allocating.
+     */
+    uint32_t count(size_t item_bytes)
+    {
+        uint32_t n = get<uint32_t>();
+        if(m_ok == false || (size_t)n * item_bytes > m_size - m_pos)
+        {
+            m_ok = false;
+            return 0;
+        }
+        return n;
+    }
+
+    std::string string()
+    {
+        uint32_t n = get<uint32_t>();
+        if(m_ok == false || n > m_size - m_pos)
+        {
+            m_ok = false;
+            return "";
+        }
+        std::string s(m_data + m_pos, n);
+        m_pos += n;
+        return s;
+    }
+
+    template<typename T>
+    void array(std::vector<T>& out)
+    {
+        uint32_t n = get<uint32_t>();
+        if(m_ok == false || (size_t)n * sizeof(T) > m_size - m_pos)
+        {
+            m_ok = false;
+            return;
+        }
+        out.resize(n);
+        bytes(out.data(), sizeof(T) * n);
+    }
+
+private:
+    const char* m_data;
+    size_t      m_size;
+    size_t      m_pos{0};
+    bool        m_ok{true};
+};
+
+class Writer
+{
+public:
+    explicit Writer(std::ofstream& file) : m_file(file) {}
+
+    void bytes(const void* data, size_t n) { m_file.write((const char*)data, n); }
+
+    template<typename T>
+    void put(const T& value) { bytes(&value, sizeof(T)); }
+
+    void string(const std::string& s)
+    {
+        put<uint32_t>((uint32_t)s.size());
+        bytes(s.data(), s.size());
+    }
+
+    template<typename T>
+    void array(const std::vector<T>& v)
+    {
+        put<uint32_t>((uint32_t)v.size());
+        bytes(v.data(), sizeof(T) * v.size());
+    }
+
+private:
+    std::ofstream& m_file;
+};
+
+struct Stamp
+{
+    uint64_t size{0};
+    int64_t  mtime{0};
+};
+
+static bool source_stamp(const std::string& source, Stamp& stamp)
+{
+    std::error_code ec;
+    stamp.size = std::filesystem::file_size(source, ec);
+    if(ec)
+        return false;
+    auto time = std::filesystem::last_write_time(source, ec);
+    if(ec)
+        return false;
+    stamp.mtime = (int64_t)time.time_since_epoch().count();
+    return true;
+}
+
+// glm::quat memory order depends on GLM_FORCE_QUAT_DATA_WXYZ, so write the components explicitly
+static void put_quat(Writer& w, const glm::quat& q)
+{
+    float v[4] = {q.w, q.x, q.y, q.z};
+    w.bytes(v, sizeof(v));
+}
+
+static glm::quat get_quat(Reader& r)
+{
+    float v[4];
+    r.bytes(v, sizeof(v));
+    return glm::quat(v[0], v[1], v[2], v[3]);
+}
+
+/**
+ * @brief an integral value in [0, n). vertex attributes store indices as floats
+ */
+static bool valid_index(float value, size_t n)
+{
+    return value >= 0.0f && value < (float)n && value == std::floor(value);
+}
+
+/**
+ * @brief references inside the data. a damaged cache must not reach the gpu with out of range
+ *        vertex fetches or joint / material indices
+ */
+static bool validate(const ModelData& data)
+{
+    int joint_n = (int)data.joints.size();
+    for(int i = 0; i < joint_n; ++i)
+    {
+        int parent = data.joints[i].parent_index;
+        if(parent < -1 || parent >= joint_n || parent == i)
+            return false;
+    }
+
+    for(const auto& mesh : data.meshes)
+    {
+        if(mesh.indices.size() % 3 != 0)
+            return false;
+        for(unsigned int idx : mesh.indices)
+        {
+            if(idx >= mesh.vertices.size())
+                return false;
+        }
+
+        // vertices without a material use the default one
+        size_t material_n = std::max<size_t>(1, mesh.materials.size());
+        size_t joint_order_n = mesh.joint_order.size();
+        if(mesh.is_skinned && mesh.joint_bind_trf_inv.size() != joint_order_n)
+            return false;
+
+        for(const auto& v : mesh.vertices)
+        {
+            if(valid_index(v.material_id.x, material_n) == false)
+                return false;
+            if(mesh.is_skinned == false)
+                continue;
+            for(int k = 0; k < 4; ++k)
+            {
+                if(valid_index(v.skinning_idxes[k], joint_order_n) == false)
+                    return false;
+            }
+        }
+    }
+    return true;
+}
+
+std::string path(const std::string& source, float scale)
+{
+    std::string dir = AGL_MODEL_CACHE_DIR;
+    if(dir.empty())
+        return "";
+
+    std::error_code ec;
+    std::string key = std::filesystem::absolute(source, ec).lexically_normal().string() + "|" + std::to_string(scale);
+
+    // FNV-1a 64
+    uint64_t hash = 14695981039346656037ULL;
+    for(unsigned char c : key)
+    {
+        hash ^= c;
+        hash *= 1099511628211ULL;
+    }
+
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.aglm", (unsigned long long)hash);
+    return std::string(AGL_PATH) + dir + "/" + name;
+}
+
+bool load(const std::string& cache_path, const std::string& source, float scale, ModelData& data)
+{
+    Stamp stamp;
+    if(source_stamp(source, stamp) == false)
+        return false;
+
+    std::vector<char> buffer;
+    if(read_file(cache_path, buffer) == false)
+        return false;
+
+    Reader r(buffer.data(), buffer.size());
+
+    // header
+    char magic[4];
+    r.bytes(magic, 4);
+    if(std::memcmp(magic, MAGIC, 4) != 0 || r.get<uint32_t>() != VERSION)
+        return false;
+    if(r.get<uint32_t>() != (uint32_t)sizeof(core::VertexGL))
+        return false;
+    if(r.get<uint64_t>() != stamp.size || r.get<int64_t>() != stamp.mtime || r.get<float>() != scale)
+        return false;
+    if(r.get<uint32_t>() != AGL_VERTEX_CACHE_SIZE || r.get<float>() != AGL_OVERDRAW_THRESHOLD)
+        return false;
+
+    ModelData result;
+
+    // joints
+    const size_t STRING_BYTES = sizeof(uint32_t);
+    const size_t ARRAY_BYTES  = sizeof(uint32_t);
+    result.joints.resize(r.count(STRING_BYTES + sizeof(int32_t) + 2 * sizeof(glm::vec3) + 8 * sizeof(float)));
+    for(auto& joint : result.joints)
+    {
+        if(r.ok() == false)
+            return false;
+        joint.name         = r.string();
+        joint.parent_index = r.get<int32_t>();
+        joint.local_T      = r.get<glm::vec3>();
+        joint.local_S      = r.get<glm::vec3>();
+        joint.local_R      = get_quat(r);
+        joint.pre_R        = get_quat(r);
+    }
+
+    // meshes
+    result.meshes.resize(r.count(sizeof(uint8_t) + 6 * ARRAY_BYTES));
+    for(auto& mesh : result.meshes)
+    {
+        if(r.ok() == false)
+            return false;
+        mesh.is_skinned = r.get<uint8_t>() != 0;
+        r.array(mesh.vertices);
+        r.array(mesh.indices);
+        r.array(mesh.joint_bind_trf_inv);
+
+        mesh.joint_order.resize(r.count(STRING_BYTES));
+        for(auto& name : mesh.joint_order)
+            name = r.string();
+
+        uint32_t n = r.count(STRING_BYTES + sizeof(int32_t));
+        for(uint32_t i = 0; i < n && r.ok(); ++i)
+        {
+            std::string name = r.string();
+            mesh.name_to_idx[name] = r.get<int32_t>();
+        }
+
+        mesh.materials.resize(r.count(sizeof(glm::vec3) + ARRAY_BYTES));
+        for(auto& material : mesh.materials)
+        {
+            if(r.ok() == false)
+                return false;
+            material.albedo = r.get<glm::vec3>();
+            material.textures.resize(r.count(sizeof(int32_t) + STRING_BYTES));
+            for(auto& texture : material.textures)
+            {
+                texture.first = r.get<int32_t>();
+                texture.second = r.string();
+            }
+        }
+    }
+
+    if(r.ok() == false || validate(result) == false)
+        return false;
+    data = std::move(result);
+    return true;
+}
+
+bool save(const std::string& cache_path, const std::string& source, float scale, const ModelData& data)
+{
+    Stamp stamp;
+    if(source_stamp(source, stamp) == false)
+        return false;
+
+    std::error_code ec;
+    std::filesystem::create_directories(std::filesystem::path(cache_path).parent_path(), ec);
+
+    // write to a temporary file first, so that another process never reads a half written cache.
+    // the name is unique so that processes importing the same model don't write the same file
+    std::random_device random;
+    char suffix[32];
+    std::snprintf(suffix, sizeof(suffix), ".%08x%08x.tmp", (unsigned int)random(), (unsigned int)random());
+    std::string tmp = cache_path + suffix;
+    {
+        std::ofstream file(tmp, std::ios::binary);
+        if(!file)
+            return false;
+        Writer w(file);
+
+        w.bytes(MAGIC, 4);
+        w.put<uint32_t>(VERSION);
+        w.put<uint32_t>((uint32_t)sizeof(core::VertexGL));
+        w.put<uint64_t>(stamp.size);
+        w.put<int64_t>(stamp.mtime);
+        w.put<float>(scale);
+        w.put<uint32_t>(AGL_VERTEX_CACHE_SIZE);
+        w.put<float>(AGL_OVERDRAW_THRESHOLD);
+
+        w.put<uint32_t>((uint32_t)data.joints.size());
+        for(const auto& joint : data.joints)
+        {
+            w.string(joint.name);
+            w.put<int32_t>(joint.parent_index);
+            w.put(joint.local_T);
+            w.put(joint.local_S);
+            put_quat(w, joint.local_R);
+            put_quat(w, joint.pre_R);
+        }
+
+        w.put<uint32_t>((uint32_t)data.meshes.size());
+        for(const auto& mesh : data.meshes)
+        {
+            w.put<uint8_t>(mesh.is_skinned ? 1 : 0);
+            w.array(mesh.vertices);
+            w.array(mesh.indices);
+            w.array(mesh.joint_bind_trf_inv);
+
+            w.put<uint32_t>((uint32_t)mesh.joint_order.size());
+            for(const auto& name : mesh.joint_order)
+                w.string(name);
+
+            w.put<uint32_t>((uint32_t)mesh.name_to_idx.size());
+            for(const auto& item : mesh.name_to_idx)
+            {
+                w.string(item.first);
+                w.put<int32_t>(item.second);
+            }
+
+            w.put<uint32_t>((uint32_t)mesh.materials.size());
+            for(const auto& material : mesh.materials)
+            {
+                w.put(material.albedo);
+                w.put<uint32_t>((uint32_t)material.textures.size());
+                for(const auto& texture : material.textures)
+                {
+                    w.put<int32_t>(texture.first);
+                    w.string(texture.second);
+                }
+            }
+        }
+
+        if(!file)
+        {
+            file.close();
+            std::remove(tmp.c_str());
+            return false;
+        }
+    }
+
+    std::filesystem::rename(tmp, cache_path, ec);
+    if(ec)
+        std::remove(tmp.c_str());
+    return !ec;
+}
+
+}
+}
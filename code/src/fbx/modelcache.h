@@ -0,0 +1,71 @@
+#pragma once
+#include "aOpenGL/core/mesh.h"
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace a::gl {
+
+/**
+ * @brief FBX 에서 읽은 model 을 GL upload 직전 상태로 저장한 것. FBX SDK 없이 읽고 쓸 수 있음.
+ */
+struct ModelData
+{
+    struct Joint
+    {
+        std::string name;
+        int         parent_index;
+        glm::vec3   local_T;
+        glm::vec3   local_S;
+        glm::quat   local_R;
+        glm::quat   pre_R;
+    };
+
+    struct Material
+    {
+        glm::vec3 albedo;
+        std::vector<std::pair<int, std::string>> textures; // TextureType, file path
+    };
+
+    /**
+     * @brief welded, optimized vertices and indices of core::MeshGL
+     */
+    struct Mesh
+    {
+        bool                       is_skinned{false};
+        std::vector<core::VertexGL> vertices;
+        std::vector<unsigned int>  indices;
+        std::vector<std::string>   joint_order;
+        std::map<std::string, int> name_to_idx;
+        std::vector<glm::mat4>     joint_bind_trf_inv;
+        std::vector<Material>      materials;
+    };
+
+    std::vector<Joint> joints;
+    std::vector<Mesh>  meshes;
+};
+
+/**
+ * @brief binary model cache (AGL_MODEL_CACHE_DIR). 
+ *        source fbx 의 size / mtime, scale 과 mesh optimize 설정 (AGL_VERTEX_CACHE_SIZE, AGL_OVERDRAW_THRESHOLD) 이 같을 때만 사용.
+ */
+namespace model_cache {
+
+/**
+ * @return cache file of the source. empty if the cache is disabled
+ */
+std::string path(const std::string& source, float scale);
+
+/**
+ * @return false if the cache doesn't exist, is stale or corrupted (indices, joint and material references are checked)
+ */
+bool load(const std::string& cache_path, const std::string& source, float scale, ModelData& data);
+
+bool save(const std::string& cache_path, const std::string& source, float scale, const ModelData& data);
+
+}
+
+}
\ No newline at end of file
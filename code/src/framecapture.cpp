@@ -0,0 +1,415 @@
+#include "framecapture.h"
+#include "aOpenGL/image.h"
+#include "aOpenGL/file.h"
+#include "aOpenGL/config.h"
+
+#include <stb_image_write.h>
+
+#include <algorithm>
+#include <csignal>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+
+#ifdef _WIN32
+    #define popen  _popen
+    #define pclose _pclose
+#endif
+
+namespace a::gl {
+
+static void replace_all(std::string& str, const std::string& from, const std::string& to)
+{
+    size_t pos = 0;
+    while((pos = str.find(from, pos)) != std::string::npos)
+    {
+        str.replace(pos, from.size(), to);
+        pos += to.size();
+    }
+}
+
+/**
+ * @brief quote a value for the shell of popen, so that spaces and metacharacters stay in one argument
+ */
+static std::string shell_quote(const std::string& value)
+{
+#ifdef _WIN32
+    // '"' is not allowed in windows paths
+    std::string quoted = "\"";
+    for(char c : value)
+    {
+        if(c != '"')
+            quoted += c;
+    }
+    return quoted + "\"";
+#else
+    // '...' keeps everything literal. a quote is closed, escaped and reopened
+    std::string quoted = "'";
+    for(char c : value)
+    {
+        if(c == '\'')
+            quoted += "'\\''";
+        else
+            quoted += c;
+    }
+    return quoted + "'";
+#endif
+}
+
+void FrameCapture::capture(const Settings& settings)
+{
+    // a video stream is bound to its settings. start a new one if they change.
+    bool changed = settings.format != m_settings.format || settings.path != m_settings.path ||
+                   settings.command != m_settings.command || settings.fps != m_settings.fps;
+    if(changed && active() && (is_video(settings.format) || is_video(m_settings.format)))
+        finish();
+
+    if(settings.path != m_settings.path || m_ring.empty())
+    {
+        if(file_check(settings.path) == false)
+            std::filesystem::create_directories(settings.path);
+    }
+    m_settings = settings;
+
+    if(m_ring.empty())
+    {
+        m_ring.resize(AGL_CAPTURE_PBO_NUM);
+        for(auto& slot : m_ring)
+            glGenBuffers(1, &slot.pbo);
+    }
+    if(m_threads.empty())
+    {
+        if(is_video(settings.format))
+        {
+            const char* ext = settings.format == CaptureFormat::Y4M ? ".y4m" : settings.format == CaptureFormat::MJPEG ? ".mjpeg" : "";
+            m_video_name = settings.path + "video_" + std::to_string(m_video_index++) + ext;
+        }
+        start_threads();
+    }
+
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    int width = viewport[2];
+    int height = viewport[3];
+    size_t size = (size_t)width * height * 3;
+
+    // oldest frame of the ring. it was issued AGL_CAPTURE_PBO_NUM - 1 frames ago.
+    Slot& slot = m_ring[m_head];
+    m_head = (m_head + 1) % (int)m_ring.size();
+    resolve(slot);
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+    if(slot.size != size)
+    {
+        glBufferData(GL_PIXEL_PACK_BUFFER, size, nullptr, GL_STREAM_READ);
+        slot.size = size;
+    }
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(viewport[0], viewport[1], width, height, GL_RGB, GL_UNSIGNED_BYTE, nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    if(is_video(settings.format))
+    {
+        if(settings.format == CaptureFormat::PIPE)
+        {
+            slot.frame.name = settings.command.empty() ? AGL_CAPTURE_COMMAND : settings.command;
+            replace_all(slot.frame.name, "{output}", shell_quote(m_video_name));
+        }
+        else
+            slot.frame.name = m_video_name;
+    }
+    else
+    {
+        const char* ext = settings.format == CaptureFormat::RAW ? ".ppm" : ".png";
+        slot.frame.name = settings.path + std::to_string(m_index++) + ext;
+    }
+    slot.frame.format = settings.format;
+    slot.frame.width = width;
+    slot.frame.height = height;
+    slot.frame.fps = settings.fps;
+    slot.pending = true;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stats.captured++;
+}
+
+void FrameCapture::resolve(Slot& slot)
+{
+    if(slot.pending == false)
+        return;
+    slot.pending = false;
+
+    Frame frame = std::move(slot.frame);
+    slot.frame = Frame();
+
+    if(reserve(is_video(frame.format)) == false)
+        return;
+
+    // take a recycled buffer
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if(m_free.empty() == false)
+        {
+            frame.pixels = std::move(m_free.back());
+            m_free.pop_back();
+        }
+    }
+    frame.pixels.resize(slot.size);
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+    void* data = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, slot.size, GL_MAP_READ_BIT);
+    if(data)
+    {
+        std::memcpy(frame.pixels.data(), data, slot.size);
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    if(data)
+        push(std::move(frame));
+}
+
+bool FrameCapture::reserve(bool video)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if(m_queue.size() < AGL_CAPTURE_QUEUE_SIZE)
+        return true;
+
+    // image: 버림. video: frame 을 빠뜨리면 안되므로 writer 를 기다림 (backpressure).
+    if(video == false)
+    {
+        m_stats.dropped++;
+        return false;
+    }
+    m_stats.stalls++;
+    m_space_cv.wait(lock, [this]{ return m_queue.size() < AGL_CAPTURE_QUEUE_SIZE; });
+    return true;
+}
+
+void FrameCapture::push(Frame&& frame)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_queue.push_back(std::move(frame));
+    }
+    m_cv.notify_one();
+}
+
+void FrameCapture::start_threads()
+{
+    // video must be written in order by a single writer
+    int thread_n = AGL_CAPTURE_THREADS;
+    if(thread_n <= 0)
+        thread_n = std::max(1, (int)std::thread::hardware_concurrency() / 2);
+    if(is_video(m_settings.format))
+        thread_n = 1;
+
+    m_stop = false;
+    for(int i = 0; i < thread_n; ++i)
+        m_threads.emplace_back(&FrameCapture::encode_loop, this);
+}
+
+void FrameCapture::encode_loop()
+{
+    while(true)
+    {
+        Frame frame;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cv.wait(lock, [this]{ return m_stop || m_queue.empty() == false; });
+            if(m_queue.empty())
+                return; // stopped and drained
+            frame = std::move(m_queue.front());
+            m_queue.pop_front();
+        }
+        m_space_cv.notify_one();
+
+        if(is_video(frame.format))
+            write_stream(frame);
+        else
+            write(frame);
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_free.push_back(std::move(frame.pixels));
+    }
+}
+
+void FrameCapture::write(const Frame& frame)
+{
+    // pixels are bottom-up (OpenGL). both formats are written top-down.
+    size_t stride = (size_t)frame.width * 3;
+    const unsigned char* last_row = frame.pixels.data() + stride * (frame.height - 1);
+
+    if(frame.format == CaptureFormat::RAW)
+    {
+        FILE* file = std::fopen(frame.name.c_str(), "wb");
+        if(file == nullptr)
+        {
+            std::cout << "FrameCapture: failed to open " << frame.name << std::endl;
+            return;
+        }
+        std::fprintf(file, "P6\n%d %d\n255\n", frame.width, frame.height);
+        for(int y = 0; y < frame.height; ++y)
+            std::fwrite(last_row - stride * y, 1, stride, file);
+        std::fclose(file);
+    }
+    else
+    {
+        // negative stride flips the image without touching the global stb flip flag
+        Image::save_image(frame.name, (const char*)last_row, frame.width, frame.height, 3, false, -(int)stride);
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stats.written++;
+}
+
+bool FrameCapture::open_stream(const Frame& frame)
+{
+    m_stream_width = frame.width;
+    m_stream_height = frame.height;
+
+    if(frame.format == CaptureFormat::PIPE)
+    {
+#ifndef _WIN32
+        // a dead child process must not kill the app
+        std::signal(SIGPIPE, SIG_IGN);
+#endif
+        std::string command = frame.name;
+        replace_all(command, "{width}", std::to_string(frame.width));
+        replace_all(command, "{height}", std::to_string(frame.height));
+        replace_all(command, "{fps}", std::to_string(frame.fps));
+#ifdef _WIN32
+        m_stream = popen(command.c_str(), "wb");
+#else
+        m_stream = popen(command.c_str(), "w");
+#endif
+        m_pipe = true;
+    }
+    else
+    {
+        m_stream = std::fopen(frame.name.c_str(), "wb");
+        m_pipe = false;
+    }
+
+    if(m_stream == nullptr)
+    {
+        std::cout << "FrameCapture: failed to open " << frame.name << std::endl;
+        return false;
+    }
+
+    if(frame.format == CaptureFormat::Y4M)
+        std::fprintf(m_stream, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C444\n", frame.width, frame.height, frame.fps);
+    return true;
+}
+
+static void write_jpg(void* context, void* data, int size)
+{
+    std::fwrite(data, 1, size, (FILE*)context);
+}
+
+void FrameCapture::write_stream(const Frame& frame)
+{
+    bool opened = m_stream != nullptr || (m_stream_width == 0 && open_stream(frame));
+    if(opened == false || frame.width != m_stream_width || frame.height != m_stream_height)
+    {
+        // failed stream, or the window was resized. a stream can't change its size.
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stats.dropped++;
+        return;
+    }
+
+    size_t stride = (size_t)frame.width * 3;
+    const unsigned char* last_row = frame.pixels.data() + stride * (frame.height - 1);
+    bool ok = true;
+
+    if(frame.format == CaptureFormat::PIPE)
+    {
+        for(int y = 0; y < frame.height && ok; ++y)
+            ok = std::fwrite(last_row - stride * y, 1, stride, m_stream) == stride;
+    }
+    else if(frame.format == CaptureFormat::Y4M)
+    {
+        // RGB -> BT.601 limited range YCbCr, planar 4:4:4
+        size_t plane = (size_t)frame.width * frame.height;
+        m_scratch.resize(plane * 3);
+        unsigned char* Y = m_scratch.data();
+        unsigned char* U = Y + plane;
+        unsigned char* V = U + plane;
+        for(int y = 0; y < frame.height; ++y)
+        {
+            const unsigned char* row = last_row - stride * y;
+            for(int x = 0; x < frame.width; ++x, ++Y, ++U, ++V)
+            {
+                int r = row[3 * x], g = row[3 * x + 1], b = row[3 * x + 2];
+                *Y = (unsigned char)((( 66 * r + 129 * g +  25 * b + 128) >> 8) +  16);
+                *U = (unsigned char)(((-38 * r -  74 * g + 112 * b + 128) >> 8) + 128);
+                *V = (unsigned char)(((112 * r -  94 * g -  18 * b + 128) >> 8) + 128);
+            }
+        }
+        ok = std::fputs("FRAME\n", m_stream) >= 0 && std::fwrite(m_scratch.data(), 1, m_scratch.size(), m_stream) == m_scratch.size();
+    }
+    else
+    {
+        // stb jpg writer has no stride. flip into the scratch buffer.
+        m_scratch.resize(frame.pixels.size());
+        for(int y = 0; y < frame.height; ++y)
+            std::memcpy(m_scratch.data() + stride * y, last_row - stride * y, stride);
+        ok = stbi_write_jpg_to_func(write_jpg, m_stream, frame.width, frame.height, 3, m_scratch.data(), AGL_CAPTURE_JPEG_QUALITY) != 0;
+        ok = ok && std::ferror(m_stream) == 0;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if(ok)
+        m_stats.written++;
+    else
+        m_stats.dropped++;
+}
+
+void FrameCapture::close_stream()
+{
+    if(m_stream)
+    {
+        if(m_pipe)
+            pclose(m_stream);
+        else
+            std::fclose(m_stream);
+    }
+    m_stream = nullptr;
+    m_stream_width = m_stream_height = 0;
+    m_scratch.clear();
+}
+
+void FrameCapture::finish()
+{
+    for(size_t i = 0; i < m_ring.size(); ++i)
+    {
+        resolve(m_ring[m_head]);
+        m_head = (m_head + 1) % (int)m_ring.size();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_cv.notify_all();
+    for(auto& thread : m_threads)
+        thread.join();
+    m_threads.clear();
+    close_stream();
+
+    for(auto& slot : m_ring)
+        glDeleteBuffers(1, &slot.pbo);
+    m_ring.clear();
+    m_head = 0;
+    m_free.clear();
+}
+
+CaptureStats FrameCapture::stats()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    CaptureStats stats = m_stats;
+    stats.queued = m_queue.size();
+    return stats;
+}
+
+}
@@ -0,0 +1,112 @@
+#pragma once
+#include <glad/glad.h>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "aOpenGL/capture.h"
+
+namespace a::gl {
+
+/**
+ * @brief asynchronous screen capture.
+ *        glReadPixels 는 pixel pack buffer (PBO) ring 에 쓰고, N-1 frame 뒤에 map 해서 읽음 (GPU stall 없음).
+ *        읽은 frame 은 bounded queue 에 넣고 encoder thread pool 이 파일로 저장.
+ *        image file 은 queue 가 가득 차면 render thread 를 막지 않고 frame 을 버림 (dropped).
+ *        video stream (PIPE, Y4M, MJPEG) 은 writer thread 하나가 순서대로 쓰고, queue 가 가득 차면 render thread 가 기다림.
+ */
+class FrameCapture
+{
+public:
+    struct Settings
+    {
+        std::string   path;     // directory
+        CaptureFormat format{CaptureFormat::PNG};
+        std::string   command;  // PIPE only. {width} {height} {fps} {output} are replaced
+        int           fps{30};
+    };
+
+    FrameCapture() = default;
+    ~FrameCapture() { finish(); }
+
+    /**
+     * @brief read back the current framebuffer (viewport) into the ring.
+     *        image: path + index + extension, video: path + "video_" + index + extension
+     */
+    void capture(const Settings& settings);
+
+    /**
+     * @brief read back the frames left in the ring, wait for the encoders, close the stream and stop the threads.
+     *        GL context 가 살아 있을 때 call 해야 함.
+     */
+    void finish();
+
+    bool active() const { return m_threads.empty() == false; }
+
+    CaptureStats stats();
+
+private:
+    struct Frame
+    {
+        std::string   name;     // file path (image, Y4M, MJPEG) or command (PIPE)
+        CaptureFormat format;
+        int width{0}, height{0};
+        int fps{0};
+        std::vector<unsigned char> pixels; // RGB, bottom-up
+    };
+
+    struct Slot
+    {
+        GLuint pbo{0};
+        size_t size{0};
+        bool   pending{false};
+        Frame  frame;   // pixels are empty until mapped
+    };
+
+    static bool is_video(CaptureFormat format)
+    {
+        return format == CaptureFormat::PIPE || format == CaptureFormat::Y4M || format == CaptureFormat::MJPEG;
+    }
+
+    void start_threads();
+    void resolve(Slot& slot);
+    bool reserve(bool video);
+    void push(Frame&& frame);
+    void encode_loop();
+    void write(const Frame& frame);
+
+    // video (writer thread only)
+    bool open_stream(const Frame& frame);
+    void write_stream(const Frame& frame);
+    void close_stream();
+
+    // GL side (render thread only)
+    std::vector<Slot> m_ring;
+    int               m_head{0};
+    int               m_index{0};
+    int               m_video_index{0};
+    Settings          m_settings;
+    std::string       m_video_name;
+
+    // encoder side
+    std::vector<std::thread>  m_threads;
+    std::deque<Frame>         m_queue;
+    std::vector<std::vector<unsigned char>> m_free; // recycled pixel buffers
+    std::mutex                m_mutex;
+    std::condition_variable   m_cv;       // queue is not empty
+    std::condition_variable   m_space_cv; // queue has space (video)
+    bool                      m_stop{false};
+    CaptureStats              m_stats;
+
+    // video stream
+    FILE*                      m_stream{nullptr};
+    bool                       m_pipe{false};
+    int                        m_stream_width{0}, m_stream_height{0};
+    std::vector<unsigned char> m_scratch;
+};
+
+}
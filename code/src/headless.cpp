@@ -0,0 +1,179 @@
+#include "headless.h"
+#include <iostream>
+#include <cstdlib>
+
+#ifdef AGL_USE_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+#ifdef AGL_USE_OSMESA
+#include <GL/osmesa.h>
+#endif
+
+namespace a::gl {
+
+bool HeadlessContext::create(int width, int height)
+{
+    bool created = create_egl() || create_osmesa(width, height);
+    if(created == false)
+    {
+        std::cout << "HeadlessContext: no EGL or OSMesa context is available." << std::endl;
+        return false;
+    }
+
+    // offscreen render target
+    glGenRenderbuffers(1, &m_color);
+    glBindRenderbuffer(GL_RENDERBUFFER, m_color);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+
+    glGenRenderbuffers(1, &m_depth);
+    glBindRenderbuffer(GL_RENDERBUFFER, m_depth);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glGenFramebuffers(1, &m_fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_color);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, m_depth);
+    if(glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    {
+        std::cout << "HeadlessContext: framebuffer is not complete." << std::endl;
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        return false;
+    }
+    return true;
+}
+
+void HeadlessContext::destroy()
+{
+    if(m_context == nullptr)
+        return;
+
+    if(m_fbo)
+    {
+        glDeleteFramebuffers(1, &m_fbo);
+        glDeleteRenderbuffers(1, &m_color);
+        glDeleteRenderbuffers(1, &m_depth);
+        m_fbo = m_color = m_depth = 0;
+    }
+
+#ifdef AGL_USE_EGL
+    if(m_display)
+    {
+        EGLDisplay display = (EGLDisplay)m_display;
+        eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        eglDestroyContext(display, (EGLContext)m_context);
+        eglTerminate(display);
+        m_display = nullptr;
+        m_context = nullptr;
+    }
+#endif
+
+#ifdef AGL_USE_OSMESA
+    if(m_context)
+    {
+        OSMesaDestroyContext((OSMesaContext)m_context);
+        free(m_osmesa_buffer);
+        m_osmesa_buffer = nullptr;
+        m_context = nullptr;
+    }
+#endif
+}
+
+bool HeadlessContext::create_egl()
+{
+#ifdef AGL_USE_EGL
+    // surfaceless platform does not need a display server nor a gpu
+    EGLDisplay display = EGL_NO_DISPLAY;
+    auto get_platform_display =
+        (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if(get_platform_display)
+        display = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+    if(display == EGL_NO_DISPLAY)
+        display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+    EGLint major, minor;
+    if(display == EGL_NO_DISPLAY || eglInitialize(display, &major, &minor) == EGL_FALSE)
+        return false;
+
+    EGLint config_attribs[] =
+    {
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_NONE
+    };
+    EGLConfig config;
+    EGLint config_num = 0;
+    if(eglChooseConfig(display, config_attribs, &config, 1, &config_num) == EGL_FALSE || config_num == 0)
+    {
+        eglTerminate(display);
+        return false;
+    }
+
+    eglBindAPI(EGL_OPENGL_API);
+    EGLint context_attribs[] =
+    {
+        EGL_CONTEXT_MAJOR_VERSION, 3,
+        EGL_CONTEXT_MINOR_VERSION, 3,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE
+    };
+    EGLContext context = eglCreateContext(display, config, EGL_NO_CONTEXT, context_attribs);
+    if(context == EGL_NO_CONTEXT)
+    {
+        eglTerminate(display);
+        return false;
+    }
+
+    // no surface (EGL_KHR_surfaceless_context). rendering goes to the FBO.
+    if(eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context) == EGL_FALSE ||
+       gladLoadGLLoader((GLADloadproc)eglGetProcAddress) == 0)
+    {
+        eglDestroyContext(display, context);
+        eglTerminate(display);
+        return false;
+    }
+
+    m_display = display;
+    m_context = context;
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool HeadlessContext::create_osmesa(int width, int height)
+{
+#ifdef AGL_USE_OSMESA
+    int attribs[] =
+    {
+        OSMESA_FORMAT,                OSMESA_RGBA,
+        OSMESA_DEPTH_BITS,            24,
+        OSMESA_PROFILE,               OSMESA_CORE_PROFILE,
+        OSMESA_CONTEXT_MAJOR_VERSION, 3,
+        OSMESA_CONTEXT_MINOR_VERSION, 3,
+        0
+    };
+    OSMesaContext context = OSMesaCreateContextAttribs(attribs, NULL);
+    if(context == NULL)
+        return false;
+
+    // OSMesa needs a buffer to make the context current even though we use the FBO
+    m_osmesa_buffer = malloc((size_t)width * height * 4);
+    if(OSMesaMakeCurrent(context, m_osmesa_buffer, GL_UNSIGNED_BYTE, width, height) == GL_FALSE ||
+       gladLoadGLLoader((GLADloadproc)OSMesaGetProcAddress) == 0)
+    {
+        OSMesaDestroyContext(context);
+        free(m_osmesa_buffer);
+        m_osmesa_buffer = nullptr;
+        return false;
+    }
+
+    m_context = context;
+    return true;
+#else
+    return false;
+#endif
+}
+
+}
@@ -0,0 +1,41 @@
+#pragma once
+#include <glad/glad.h>
+
+namespace a::gl {
+
+/**
+ * @brief OpenGL 3.3 core context without a window.
+ *        EGL (surfaceless / device platform) 를 먼저 시도하고, 안되면 OSMesa 사용.
+ *        default framebuffer 가 없으므로 렌더링은 FBO 에 함. (LIBGL_ALWAYS_SOFTWARE=1 이면 llvmpipe)
+ */
+class HeadlessContext
+{
+public:
+    HeadlessContext() = default;
+    ~HeadlessContext() { destroy(); }
+
+    /**
+     * @brief create the context, load glad and the FBO of width x height.
+     * @return false if no backend is available
+     */
+    bool create(int width, int height);
+    void destroy();
+
+    /**
+     * @brief render target. color: RGBA8, depth: 24 bits
+     */
+    GLuint fbo() const { return m_fbo; }
+
+private:
+    bool create_egl();
+    bool create_osmesa(int width, int height);
+
+    // backend handles (EGLDisplay, EGLContext / OSMesaContext, color buffer)
+    void* m_display{nullptr};
+    void* m_context{nullptr};
+    void* m_osmesa_buffer{nullptr};
+
+    GLuint m_fbo{0}, m_color{0}, m_depth{0};
+};
+
+}
@@ -1,5 +1,6 @@
 #include "aOpenGL/image.h"
 #include "aOpenGL/file.h"
+#include "aOpenGL/config.h"
 #include <iostream>
 
 #pragma warning(push, 0)
@@ -16,47 +17,57 @@
 namespace a::gl {
 
 Image::Image()
-{}
+{
+    m_stats.bytes_budget = AGL_IMAGE_CACHE_BUDGET;
+}
 
-Image::spData Image::_load(std::string path, int in_channel)
+static size_t image_bytes(const Image::spData& data)
 {
-    if(m_images.find(path) == m_images.end())
-    {
-        if(!file_check(path))
-            std::cout << "file not found: " << path << std::endl;
-        else
-            std::cout << "image load: " << path << std::endl;
-        
-        stbi_set_flip_vertically_on_load(true);
-        int width, height, channel;
-        auto img = stbi_load(path.c_str(), &width, &height, &channel, in_channel);
-        if(img == nullptr)
-        {
-            std::cout << "- stbi_load failed: " << stbi_failure_reason() << std::endl;
-        }
-        
-        auto data = std::make_shared<Image::Data>();
-        data->path = path;
-        data->width = width;
-        data->height = height;
-        if(in_channel == 0)
-            data->channel = channel;
-        else
-            data->channel = in_channel;
-        data->image = img;
-        m_images.insert(std::pair<std::string, Image::spData>(path, data));        
-    }
-    return m_images.at(path);
+    if(data->image == nullptr)
+        return 0;
+    return (size_t)data->width * (size_t)data->height * (size_t)data->channel;
 }
 
-Image::spData Image::_create(std::string path, unsigned char* img, int width, int height, int channel)
+Image::spData Image::_load(std::string path, int in_channel)
 {
     auto iter = m_images.find(path);
     if(iter != m_images.end())
     {
-        Image::_free_image(path);
-        m_images.erase(path);
+        m_stats.hits++;
+        m_lru.splice(m_lru.begin(), m_lru, iter->second.lru);
+        return iter->second.data;
     }
+    m_stats.misses++;
+
+    if(!file_check(path))
+        std::cout << "file not found: " << path << std::endl;
+    else
+        std::cout << "image load: " << path << std::endl;
+    
+    stbi_set_flip_vertically_on_load(true);
+    int width = 0, height = 0, channel = 0;
+    auto img = stbi_load(path.c_str(), &width, &height, &channel, in_channel);
+    if(img == nullptr)
+    {
+        std::cout << "- stbi_load failed: " << stbi_failure_reason() << std::endl;
+    }
+    
+    auto data = std::make_shared<Image::Data>();
+    data->path = path;
+    data->width = width;
+    data->height = height;
+    if(in_channel == 0)
+        data->channel = channel;
+    else
+        data->channel = in_channel;
+    data->image = img;
+    _insert(path, data);
+    return data;
+}
+
+Image::spData Image::_create(std::string path, unsigned char* img, int width, int height, int channel)
+{
+    Image::_free_image(path);
 
     auto data = std::make_shared<Image::Data>();
     data->path = path;
@@ -64,11 +75,52 @@ Image::spData Image::_create(std::string path, unsigned char* img, int width, in
     data->height = height;
     data->channel = channel;
     data->image = img;
-    m_images.insert(std::pair<std::string, Image::spData>(path, data));
+    _insert(path, data);
     
     return data;
 }
 
+void Image::_insert(const std::string& path, Image::spData data)
+{
+    m_lru.push_front(path);
+
+    Entry entry;
+    entry.data  = data;
+    entry.bytes = image_bytes(data);
+    entry.lru   = m_lru.begin();
+    m_images.insert(std::pair<std::string, Entry>(path, entry));
+
+    m_stats.bytes_resident += entry.bytes;
+    m_stats.entries = m_images.size();
+    _evict();
+}
+
+void Image::_evict()
+{
+    if(m_stats.bytes_budget == 0)
+        return;
+
+    // from the least recently used. images referenced outside of the cache are pinned.
+    auto it = m_lru.end();
+    while(m_stats.bytes_resident > m_stats.bytes_budget && it != m_lru.begin())
+    {
+        --it;
+        auto iter = m_images.find(*it);
+        if(iter->second.data.use_count() > 1)
+            continue;
+
+        auto victim = it++;
+        m_stats.evictions++;
+        _free_image(*victim);
+    }
+}
+
+void Image::_set_budget(size_t bytes)
+{
+    m_stats.bytes_budget = bytes;
+    _evict();
+}
+
 Image::spDataHDR Image::_load_hdr(std::string path)
 {
     auto iter = m_hdrs.find(path);
@@ -99,23 +151,43 @@ void Image::_free_image(std::string path)
     auto iter = m_images.find(path);
     if(iter == m_images.end())
         return;
-    stbi_image_free(iter->second->image);
+    stbi_image_free(iter->second.data->image);
     //free(iter->second->image);
+    iter->second.data->image = nullptr;
+
+    m_stats.bytes_resident -= iter->second.bytes;
+    m_lru.erase(iter->second.lru);
     m_images.erase(iter);
+    m_stats.entries = m_images.size();
+}
+
+bool Image::_release(std::string path)
+{
+    auto iter = m_images.find(path);
+    if(iter == m_images.end())
+        return false;
+    if(iter->second.data.use_count() > 1)
+        return false;
+    _free_image(path);
+    return true;
 }
 
 void Image::save_image(std::string save_name, spData data, bool flip)
 {
-    if(flip)
-        stbi_flip_vertically_on_write(true);
-    stbi_write_png(save_name.c_str(), data->width, data->height, data->channel, data->image, 0);
+    save_image(save_name, (const char*)data->image, data->width, data->height, data->channel, flip, 0);
 }
 
-void Image::save_image(std::string save_name, const char* data, int width, int height, int channel, bool flip)
+void Image::save_image(std::string save_name, const char* data, int width, int height, int channel, bool flip, int stride)
 {
+    // flip with a negative stride. stbi_flip_vertically_on_write is global and encoder threads save at the same time
+    if(stride == 0)
+        stride = width * channel;
     if(flip)
-        stbi_flip_vertically_on_write(true);
-    stbi_write_png(save_name.c_str(), width, height, channel, data, 0);
+    {
+        data += (ptrdiff_t)(height - 1) * stride;
+        stride = -stride;
+    }
+    stbi_write_png(save_name.c_str(), width, height, channel, data, stride);
 }
 
 }
\ No newline at end of file
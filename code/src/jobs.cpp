@@ -0,0 +1,191 @@
+#include "aOpenGL/jobs.h"
+#include "aOpenGL/config.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <stdexcept>
+
+namespace a::gl {
+
+JobSystem::JobSystem()
+{
+    int thread_n = AGL_JOB_THREADS;
+    if(thread_n <= 0)
+        thread_n = (int)std::thread::hardware_concurrency() - 1;
+
+    for(int i = 0; i < thread_n; ++i)
+        m_threads.emplace_back(&JobSystem::_worker, this);
+}
+
+void JobSystem::_worker()
+{
+    while(true)
+    {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cv.wait(lock, [this]{ return m_jobs.empty() == false; });
+            job = std::move(m_jobs.front());
+            m_jobs.pop_front();
+        }
+        job();
+    }
+}
+
+bool JobSystem::_run_one()
+{
+    std::function<void()> job;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if(m_jobs.empty())
+            return false;
+        job = std::move(m_jobs.front());
+        m_jobs.pop_front();
+    }
+    job();
+    return true;
+}
+
+void JobSystem::_parallel_for(int count, const std::function<void(int)>& func, int grain)
+{
+    if(count <= 0)
+        return;
+
+    // a few jobs per thread for load balancing
+    int worker_n = (int)m_threads.size() + 1;
+    if(grain <= 0)
+        grain = std::max(1, count / (worker_n * 4));
+
+    int job_n = (count + grain - 1) / grain;
+    if(job_n == 1 || m_threads.empty())
+    {
+        for(int i = 0; i < count; ++i)
+            func(i);
+        return;
+    }
+
+    // state of this call. jobs always count down, even if func throws
+    struct Batch
+    {
+        std::atomic<int>        remaining;
+        std::mutex              mutex;
+        std::condition_variable cv;
+        std::exception_ptr      error;
+    } batch;
+    batch.remaining = job_n;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for(int j = 0; j < job_n; ++j)
+        {
+            int begin = j * grain;
+            int end = std::min(count, begin + grain);
+            m_jobs.push_back([&func, &batch, begin, end]{
+                std::exception_ptr error;
+                try
+                {
+                    for(int i = begin; i < end; ++i)
+                        func(i);
+                }
+                catch(...)
+                {
+                    error = std::current_exception();
+                }
+
+                std::lock_guard<std::mutex> lock(batch.mutex);
+                if(error && batch.error == nullptr)
+                    batch.error = error;
+                if(--batch.remaining == 0)
+                    batch.cv.notify_all();
+            });
+        }
+    }
+    m_cv.notify_all();
+
+    // help while there are queued jobs (other jobs may be picked up here, which is fine).
+    // when the queue is empty, the rest are running on other threads. wait for them.
+    while(batch.remaining > 0)
+    {
+        if(_run_one())
+            continue;
+        std::unique_lock<std::mutex> lock(batch.mutex);
+        batch.cv.wait(lock, [&batch]{ return batch.remaining == 0; });
+    }
+
+    // the last job may still hold the lock. batch is destroyed on return
+    std::lock_guard<std::mutex> lock(batch.mutex);
+    if(batch.error)
+        std::rethrow_exception(batch.error);
+}
+
+void FrameGraph::add(const std::string& name, int count, Job job, const std::vector<std::string>& depends)
+{
+    m_stages.push_back(Stage{name, count, job, depends});
+    m_order.clear();
+}
+
+void FrameGraph::resize(const std::string& name, int count)
+{
+    for(auto& stage : m_stages)
+    {
+        if(stage.name == name)
+            stage.count = count;
+    }
+}
+
+void FrameGraph::clear()
+{
+    m_stages.clear();
+    m_order.clear();
+    m_timings.clear();
+}
+
+void FrameGraph::sort()
+{
+    int n = (int)m_stages.size();
+    std::vector<int> state(n, 0); // 0: new, 1: visiting, 2: done
+
+    std::function<void(int)> visit = [&](int i)
+    {
+        if(state[i] == 2)
+            return;
+        if(state[i] == 1)
+            throw std::runtime_error("FrameGraph: dependency cycle at " + m_stages[i].name);
+
+        state[i] = 1;
+        for(const auto& dep : m_stages[i].depends)
+        {
+            auto it = std::find_if(m_stages.begin(), m_stages.end(), [&](const Stage& s){ return s.name == dep; });
+            if(it == m_stages.end())
+                throw std::runtime_error("FrameGraph: unknown dependency " + dep + " of " + m_stages[i].name);
+            visit((int)(it - m_stages.begin()));
+        }
+        state[i] = 2;
+        m_order.push_back(i);
+    };
+
+    m_order.clear();
+    for(int i = 0; i < n; ++i)
+        visit(i);
+}
+
+void FrameGraph::run()
+{
+    if(m_order.size() != m_stages.size())
+        sort();
+
+    m_timings.resize(m_order.size());
+    for(int k = 0; k < (int)m_order.size(); ++k)
+    {
+        const auto& stage = m_stages[m_order[k]];
+        auto begin = std::chrono::steady_clock::now();
+        JobSystem::parallel_for(stage.count, stage.job);
+        auto end = std::chrono::steady_clock::now();
+
+        m_timings[k].name = stage.name;
+        m_timings[k].ms = std::chrono::duration<double, std::milli>(end - begin).count();
+    }
+}
+
+}
@@ -0,0 +1,503 @@
+#include "aOpenGL/kin/kincompressed.h"
+#include "aOpenGL/jobs.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <stdexcept>
+
+namespace a::gl {
+
+// smallest-three: 2 bit index of the largest component + 3 x 15 bit
+static const float kQuatRange = 0.70710678f; // |other components| <= 1 / sqrt(2)
+static const float kQuatSteps = 32767.0f;
+
+static void encode_quat(const Quat& q, uint16_t* out)
+{
+    float c[4] = { q.x(), q.y(), q.z(), q.w() };
+    int largest = 0;
+    for(int i = 1; i < 4; ++i)
+    {
+        if(std::abs(c[i]) > std::abs(c[largest]))
+            largest = i;
+    }
+
+    // q and -q are the same rotation. make the dropped component positive
+    float sign = (c[largest] < 0.0f) ? -1.0f : 1.0f;
+    int k = 0;
+    for(int i = 0; i < 4; ++i)
+    {
+        if(i == largest)
+            continue;
+        float v = std::min(1.0f, std::max(-1.0f, sign * c[i] / kQuatRange));
+        out[k++] = (uint16_t)std::lround((v * 0.5f + 0.5f) * kQuatSteps);
+    }
+    out[0] |= (uint16_t)((largest & 1) << 15);
+    out[1] |= (uint16_t)((largest >> 1) << 15);
+}
+
+static Quat decode_quat(const uint16_t* in)
+{
+    int largest = (in[0] >> 15) | ((in[1] >> 15) << 1);
+
+    float c[4];
+    float sum = 0.0f;
+    int k = 0;
+    for(int i = 0; i < 4; ++i)
+    {
+        if(i == largest)
+            continue;
+        float v = (in[k++] & 0x7fff) / kQuatSteps;
+        c[i] = (v * 2.0f - 1.0f) * kQuatRange;
+        sum += c[i] * c[i];
+    }
+    c[largest] = std::sqrt(std::max(0.0f, 1.0f - sum));
+    return Quat(c[3], c[0], c[1], c[2]);
+}
+
+static Quat nlerp(const Quat& q0, const Quat& q1, float t)
+{
+    float s = (q0.dot(q1) < 0.0f) ? -1.0f : 1.0f;
+    Vec4 v = (1.0f - t) * q0.coeffs() + (s * t) * q1.coeffs();
+    v.normalize();
+    return Quat(v.w(), v.x(), v.y(), v.z());
+}
+
+/**
+ * @return index of the key segment [k, k + 1] that contains frame. frames are sorted and frames[0] == 0
+ */
+static int find_key(const uint16_t* frames, int key_num, int frame)
+{
+    const uint16_t* it = std::upper_bound(frames, frames + key_num, (uint16_t)frame);
+    return std::max(0, (int)(it - frames) - 1);
+}
+
+/**
+ * @brief rotation of a track at frame f
+ */
+static Quat sample_rotation(const uint16_t* frames, const uint16_t* keys, int key_num, int f)
+{
+    int k = find_key(frames, key_num, f);
+    Quat q0 = decode_quat(keys + (size_t)k * 3);
+    if(k + 1 >= key_num || frames[k] == f)
+        return q0;
+    Quat q1 = decode_quat(keys + (size_t)(k + 1) * 3);
+    return nlerp(q0, q1, (float)(f - frames[k]) / (frames[k + 1] - frames[k]));
+}
+
+/**
+ * @brief position of a track at frame f. value = pmin + key * step
+ */
+static Vec3 sample_position(const uint16_t* frames, const uint16_t* keys, int key_num, const Vec3& pmin, const Vec3& step, int f)
+{
+    int k = find_key(frames, key_num, f);
+    int k1 = std::min(k + 1, key_num - 1);
+    float t = (k1 == k) ? 0.0f : (float)(f - frames[k]) / (frames[k1] - frames[k]);
+
+    Vec3 p;
+    for(int a = 0; a < 3; ++a)
+    {
+        float p0 = pmin[a] + keys[(size_t)k * 3 + a] * step[a];
+        float p1 = pmin[a] + keys[(size_t)k1 * 3 + a] * step[a];
+        p[a] = (1.0f - t) * p0 + t * p1;
+    }
+    return p;
+}
+
+/**
+ * @brief greedy key reduction. 한 segment 를 galloping + binary search 로 최대한 늘림.
+ *        fits(s, e): frames in (s, e) are within tolerance when interpolated from the keys s and e.
+ *        fits 가 monotone 하지 않아도 선택된 segment 는 항상 검사를 통과한 것.
+ * @return key frame indices. first and last frame are always keys
+ */
+template<typename Fits>
+static std::vector<int> reduce_keys(int n, const Fits& fits)
+{
+    std::vector<int> keys;
+    keys.push_back(0);
+    int s = 0;
+    while(s < n - 1)
+    {
+        // gallop: s + 2, s + 4, s + 8, ...
+        int good = s + 1, bad = -1;
+        for(int step = 2; ; step *= 2)
+        {
+            int e = std::min(n - 1, s + step);
+            if(fits(s, e) == false)
+            {
+                bad = e;
+                break;
+            }
+            good = e;
+            if(e == n - 1)
+                break;
+        }
+
+        // binary search in (good, bad)
+        if(bad > 0)
+        {
+            while(bad - good > 1)
+            {
+                int mid = good + (bad - good) / 2;
+                if(fits(s, mid))
+                    good = mid;
+                else
+                    bad = mid;
+            }
+        }
+        keys.push_back(good);
+        s = good;
+    }
+    return keys;
+}
+
+static std::vector<int> all_keys(int n)
+{
+    std::vector<int> keys(n);
+    for(int f = 0; f < n; ++f)
+        keys[f] = f;
+    return keys;
+}
+
+/**
+ * @brief longest bone chain below each joint (sum of bone lengths). rotation error of the joint
+ *        moves the descendants by at most angle * reach.
+ */
+static std::vector<float> joint_reaches(const spKinModel& kmodel)
+{
+    std::vector<float> reach(kmodel->noj, 0.0f);
+    for(int i = (int)kmodel->fk_order.size() - 1; i >= 0; --i)
+    {
+        int jidx = kmodel->fk_order.at(i);
+        int pidx = kmodel->parent_idxes.at(jidx);
+        if(pidx < 0)
+            continue;
+        float bone = kmodel->pre_trfs.at(jidx).block<3, 1>(0, 3).norm();
+        reach[pidx] = std::max(reach[pidx], reach[jidx] + bone);
+    }
+    return reach;
+}
+
+/**
+ * @brief compressed tracks of one motion, before being appended to KinCompressedMotion
+ */
+struct MotionTracks
+{
+    std::vector<std::vector<uint16_t>> rot_frames;  // [jidx]
+    std::vector<std::vector<uint16_t>> rot_keys;    // [jidx]
+    std::vector<uint16_t>              pos_frames;
+    std::vector<uint16_t>              pos_keys;
+    Vec3                               pos_min;
+    Vec3                               pos_step;
+    float                              error{0.0f};
+};
+
+/**
+ * @param scale tolerance scale. 0: keep all the keys
+ */
+static void compress_motion(const spKinModel&         kmodel,
+                            const Motion&             motion,
+                            const std::vector<float>& rot_tolerances,
+                            float                     pos_tolerance,
+                            float                     scale,
+                            MotionTracks&             out)
+{
+    int n = motion.poses.size();
+    int noj = kmodel->noj;
+    out.rot_frames.assign(noj, {});
+    out.rot_keys.assign(noj, {});
+    out.pos_frames.clear();
+    out.pos_keys.clear();
+
+    // rotations
+    std::vector<Quat> original(n), quantized(n);
+    std::vector<uint16_t> codes((size_t)n * 3);
+    for(int j = 0; j < noj; ++j)
+    {
+        int gl_jidx = kmodel->gl_jnt_idxes.at(j);
+        for(int f = 0; f < n; ++f)
+        {
+            original[f] = motion.poses[f].local_rotations.at(gl_jidx).normalized();
+            encode_quat(original[f], &codes[(size_t)f * 3]);
+            quantized[f] = decode_quat(&codes[(size_t)f * 3]);
+        }
+
+        // |dot| >= cos(angle / 2)
+        float min_dot = std::cos(0.5f * scale * rot_tolerances[j]);
+        auto fits = [&](int s, int e)
+        {
+            for(int f = s + 1; f < e; ++f)
+            {
+                Quat q = nlerp(quantized[s], quantized[e], (float)(f - s) / (e - s));
+                if(std::abs(q.dot(original[f])) < min_dot)
+                    return false;
+            }
+            return true;
+        };
+
+        std::vector<int> keys = (scale > 0.0f) ? reduce_keys(n, fits) : all_keys(n);
+        for(int f : keys)
+        {
+            out.rot_frames[j].push_back((uint16_t)f);
+            out.rot_keys[j].insert(out.rot_keys[j].end(), &codes[(size_t)f * 3], &codes[(size_t)f * 3 + 3]);
+        }
+    }
+
+    // root position. 16 bit per axis in the range of the motion
+    Vec3 pmin = Vec3::Constant(1e30f), pmax = Vec3::Constant(-1e30f);
+    for(const auto& pose : motion.poses)
+    {
+        pmin = pmin.cwiseMin(pose.root_position);
+        pmax = pmax.cwiseMax(pose.root_position);
+    }
+    out.pos_min = pmin;
+    out.pos_step = ((pmax - pmin) / 65535.0f).cwiseMax(Vec3::Constant(1e-8f));
+
+    std::vector<Vec3> pos_quantized(n);
+    std::vector<uint16_t> pos_codes((size_t)n * 3);
+    for(int f = 0; f < n; ++f)
+    {
+        for(int k = 0; k < 3; ++k)
+        {
+            float u = std::round((motion.poses[f].root_position[k] - pmin[k]) / out.pos_step[k]);
+            pos_codes[(size_t)f * 3 + k] = (uint16_t)std::min(65535.0f, std::max(0.0f, u));
+            pos_quantized[f][k] = pmin[k] + pos_codes[(size_t)f * 3 + k] * out.pos_step[k];
+        }
+    }
+
+    float pos_tol = scale * pos_tolerance;
+    auto pos_fits = [&](int s, int e)
+    {
+        for(int f = s + 1; f < e; ++f)
+        {
+            float t = (float)(f - s) / (e - s);
+            Vec3 p = (1.0f - t) * pos_quantized[s] + t * pos_quantized[e];
+            if((p - motion.poses[f].root_position).norm() > pos_tol)
+                return false;
+        }
+        return true;
+    };
+    std::vector<int> pos_keys = (scale > 0.0f) ? reduce_keys(n, pos_fits) : all_keys(n);
+    for(int f : pos_keys)
+    {
+        out.pos_frames.push_back((uint16_t)f);
+        out.pos_keys.insert(out.pos_keys.end(), &pos_codes[(size_t)f * 3], &pos_codes[(size_t)f * 3 + 3]);
+    }
+}
+
+/**
+ * @brief decompress frame f of the tracks
+ */
+static void decompress_tracks(const MotionTracks& tracks, int noj, int f, Vec3& root_position, std::vector<Quat>& local_rots)
+{
+    for(int j = 0; j < noj; ++j)
+        local_rots[j] = sample_rotation(tracks.rot_frames[j].data(), tracks.rot_keys[j].data(), tracks.rot_frames[j].size(), f);
+    root_position = sample_position(tracks.pos_frames.data(), tracks.pos_keys.data(), tracks.pos_frames.size(),
+                                    tracks.pos_min, tracks.pos_step, f);
+}
+
+/**
+ * @return max distance between the original and the decompressed world joint positions
+ */
+static float measure_error(const spKinModel& kmodel, const Motion& motion, const MotionTracks& tracks)
+{
+    int noj = kmodel->noj;
+    std::vector<Quat> original(noj), decoded(noj);
+    Vec3 root_position;
+    float error = 0.0f;
+    for(int f = 0; f < (int)motion.poses.size(); ++f)
+    {
+        const Pose& pose = motion.poses[f];
+        for(int j = 0; j < noj; ++j)
+            original[j] = pose.local_rotations.at(kmodel->gl_jnt_idxes.at(j));
+        decompress_tracks(tracks, noj, f, root_position, decoded);
+
+        Vec4 p0, p1;
+        p0 << pose.root_position, 1.0f;
+        p1 << root_position, 1.0f;
+        auto trfs0 = kin::compute_fk(kmodel, Mat4::Identity(), p0, original);
+        auto trfs1 = kin::compute_fk(kmodel, Mat4::Identity(), p1, decoded);
+        for(int j = 0; j < noj; ++j)
+            error = std::max(error, (trfs0[j].block<3, 1>(0, 3) - trfs1[j].block<3, 1>(0, 3)).norm());
+    }
+    return error;
+}
+
+spKinCompressedMotion kincompressed(const spKinModel& kmodel, const std::vector<Motion>& motions, const KinCompressOption& option)
+{
+    auto cmotion = std::make_shared<KinCompressedMotion>();
+    cmotion->kmodel = kmodel;
+    int nom = motions.size();
+    int noj = kmodel->noj;
+
+    for(const auto& motion : motions)
+    {
+        if(motion.poses.size() > 65536)
+            throw std::runtime_error("kincompressed: " + motion.name + " has more than 65536 frames");
+    }
+
+    // per joint angular tolerance: both the local angle and the movement of the descendants
+    std::vector<float> reach = joint_reaches(kmodel);
+    std::vector<float> rot_tolerances(noj);
+    for(int j = 0; j < noj; ++j)
+        rot_tolerances[j] = std::min(option.max_angle_error, option.max_position_error / std::max(reach[j], 1e-6f));
+
+    // errors of the joints add up along the chain, so the tolerances are halved until FK is within the budget,
+    // then a few bisection steps between the last failed and the passed scale.
+    // scale 0 (every frame is a key) is the last resort
+    std::vector<MotionTracks> tracks(nom);
+    JobSystem::parallel_for(nom, [&](int mid){
+        const Motion& motion = motions[mid];
+        auto attempt = [&](float scale, MotionTracks& out)
+        {
+            compress_motion(kmodel, motion, rot_tolerances, option.max_position_error, scale, out);
+            out.error = measure_error(kmodel, motion, out);
+            return out.error <= option.max_position_error;
+        };
+
+        float passed = 1.0f, failed = -1.0f;
+        for(int iter = 0; attempt(passed, tracks[mid]) == false; ++iter)
+        {
+            failed = passed;
+            passed = (iter < 8) ? passed * 0.5f : 0.0f;
+            if(passed == 0.0f)
+            {
+                attempt(passed, tracks[mid]);
+                break;
+            }
+        }
+
+        MotionTracks candidate;
+        for(int iter = 0; iter < 3 && failed > 0.0f && passed > 0.0f; ++iter)
+        {
+            float scale = 0.5f * (passed + failed);
+            if(attempt(scale, candidate))
+            {
+                passed = scale;
+                tracks[mid] = std::move(candidate);
+            }
+            else
+                failed = scale;
+        }
+    });
+
+    // set and return
+    for(int mid = 0; mid < nom; ++mid)
+    {
+        const Motion& motion = motions[mid];
+        const MotionTracks& t = tracks[mid];
+
+        cmotion->start_pidxes.push_back(cmotion->pose_n);
+        cmotion->pose_n += motion.poses.size();
+        cmotion->motion_names.push_back(motion.name);
+        cmotion->fbx_start_times.push_back(motion.start_time);
+        cmotion->fbx_end_times.push_back(motion.end_time);
+        cmotion->fps.push_back(motion.fps);
+        cmotion->position_errors.push_back(t.error);
+
+        for(int j = 0; j < noj; ++j)
+        {
+            cmotion->rot_tracks.push_back({ (uint32_t)cmotion->rot_frames.size(), (uint32_t)t.rot_frames[j].size() });
+            cmotion->rot_frames.insert(cmotion->rot_frames.end(), t.rot_frames[j].begin(), t.rot_frames[j].end());
+            cmotion->rot_keys.insert(cmotion->rot_keys.end(), t.rot_keys[j].begin(), t.rot_keys[j].end());
+        }
+
+        cmotion->pos_tracks.push_back({ (uint32_t)cmotion->pos_frames.size(), (uint32_t)t.pos_frames.size() });
+        cmotion->pos_frames.insert(cmotion->pos_frames.end(), t.pos_frames.begin(), t.pos_frames.end());
+        cmotion->pos_keys.insert(cmotion->pos_keys.end(), t.pos_keys.begin(), t.pos_keys.end());
+        cmotion->pos_mins.push_back(t.pos_min);
+        cmotion->pos_steps.push_back(t.pos_step);
+    }
+    cmotion->motion_n = nom;
+
+    return cmotion;
+}
+
+int KinCompressedMotion::motion_id(int pidx) const
+{
+    assert(pidx >= 0 && pidx < pose_n);
+    auto it = std::upper_bound(start_pidxes.begin(), start_pidxes.end(), pidx);
+    return (int)(it - start_pidxes.begin()) - 1;
+}
+
+void KinCompressedMotion::decompress(int pidx, Vec3& root_position, std::vector<Quat>& local_rots) const
+{
+    int noj = kmodel->noj;
+    int mid = motion_id(pidx);
+    int f = pidx - start_pidxes[mid];
+    local_rots.resize(noj);
+
+    for(int j = 0; j < noj; ++j)
+    {
+        const Track& track = rot_tracks[(size_t)mid * noj + j];
+        local_rots[j] = sample_rotation(rot_frames.data() + track.offset, rot_keys.data() + (size_t)track.offset * 3, track.key_num, f);
+    }
+
+    const Track& track = pos_tracks[mid];
+    root_position = sample_position(pos_frames.data() + track.offset, pos_keys.data() + (size_t)track.offset * 3, track.key_num,
+                                    pos_mins[mid], pos_steps[mid], f);
+}
+
+KinPose KinCompressedMotion::kinpose(int pidx) const
+{
+    Vec3 root_position;
+    std::vector<Quat> local_rots;
+    decompress(pidx, root_position, local_rots);
+    return a::gl::kinpose(kmodel, root_position, to_mat4<Quat>(local_rots));
+}
+
+Motion KinCompressedMotion::motion(int mid) const
+{
+    int noj = kmodel->noj;
+    int gl_noj = 0;
+    for(int gl_jidx : kmodel->gl_jnt_idxes)
+        gl_noj = std::max(gl_noj, gl_jidx + 1);
+
+    Motion m;
+    m.name = motion_names.at(mid);
+    m.start_time = fbx_start_times.at(mid);
+    m.end_time = fbx_end_times.at(mid);
+    m.fps = fps.at(mid);
+
+    int begin = start_pidxes.at(mid);
+    int end = (mid + 1 < motion_n) ? start_pidxes.at(mid + 1) : pose_n;
+    m.poses.resize(end - begin);
+
+    std::vector<Quat> local_rots(noj);
+    for(int pidx = begin; pidx < end; ++pidx)
+    {
+        Pose& pose = m.poses[pidx - begin];
+        decompress(pidx, pose.root_position, local_rots);
+        pose.local_rotations.assign(gl_noj, Quat::Identity());
+        for(int j = 0; j < noj; ++j)
+            pose.local_rotations[kmodel->gl_jnt_idxes.at(j)] = local_rots[j];
+    }
+    return m;
+}
+
+int KinCompressedMotion::get_pidx(const std::string& take_name, int fbx_frame, int fbx_fps) const
+{
+    auto it = std::find(motion_names.begin(), motion_names.end(), take_name);
+    assert(it != motion_names.end());
+    return get_pidx((int)(it - motion_names.begin()), (float)fbx_frame / (float)fbx_fps);
+}
+
+int KinCompressedMotion::get_pidx(int mid, float time) const
+{
+    assert(time >= fbx_start_times.at(mid));
+    assert(time < fbx_end_times.at(mid));
+    return start_pidxes.at(mid) + std::round(fps.at(mid) * (time - fbx_start_times.at(mid)));
+}
+
+size_t KinCompressedMotion::byte_size() const
+{
+    return rot_tracks.size() * sizeof(Track) + pos_tracks.size() * sizeof(Track)
+         + (rot_frames.size() + rot_keys.size() + pos_frames.size() + pos_keys.size()) * sizeof(uint16_t)
+         + (pos_mins.size() + pos_steps.size()) * sizeof(Vec3);
+}
+
+size_t KinCompressedMotion::raw_byte_size() const
+{
+    return (size_t)pose_n * (kmodel->noj * sizeof(Quat) + sizeof(Vec3));
+}
+
+}
\ No newline at end of file
@@ -3,42 +3,44 @@
 
 namespace a::gl {
 
+KinPose kinpose(const spKinModel& kmodel, const Vec3& root_position, const std::vector<Mat4>& local_rots)
+{
+    KinPose pose;
+
+    // world_pos = basisTrf * local_pos
+    Vec4 world_root_pos;
+    world_root_pos.head<3>() = root_position;
+    world_root_pos.w() = 1.0f;
+
+    pose.local_rots = local_rots;
+    pose.world_basisTrf = Mat4::Identity();
+    pose.root_preR  = kmodel->pre_trfs.at(0);
+    pose.local_pos  = world_root_pos;
+    pose.world_trfs = kin::compute_fk(kmodel, pose.world_basisTrf, pose.local_pos, pose.local_rots);
+
+    // this will compute root's local_pos and local_rots
+    //kin::reset_world_basisTrf(pose, pose.world_trfs.at(0));
+    kin::reset_world_basisTrf(pose, pose.get_projected_root_trf());
+    return pose;
+}
+
 static std::vector<KinPose> _get_poses(const spKinModel& kmodel,
                                        const Motion&     motion)
 {
     int pidx_n = motion.poses.size();
-    Mat4 root_preTrf = kmodel->pre_trfs.at(0);
 
     // create poses
     std::vector<KinPose> poses;
     poses.reserve(pidx_n);
+    std::vector<Mat4> local_rots(kmodel->gl_jnt_idxes.size());
     for(int i = 0; i < pidx_n; ++i)
     {
-        KinPose pose;
-
-        // world_pos = basisTrf * local_pos
-        Vec4 world_root_pos;
-        world_root_pos.head<3>() = motion.poses.at(i).root_position;
-        world_root_pos.w() = 1.0f;
-
         for(int j = 0; j < (int)kmodel->gl_jnt_idxes.size(); ++j)
         {
             int jidx = kmodel->gl_jnt_idxes.at(j);
-            pose.local_rots.push_back(
-                to_mat4(motion.poses.at(i).local_rotations.at(jidx))
-            );
+            local_rots.at(j) = to_mat4(motion.poses.at(i).local_rotations.at(jidx));
         }
-        
-        pose.world_basisTrf = Mat4::Identity();
-        pose.root_preR  = root_preTrf;
-        pose.local_pos  = world_root_pos;
-        pose.world_trfs = kin::compute_fk(kmodel, pose.world_basisTrf, pose.local_pos, pose.local_rots);
-
-        // this will compute root's local_pos and local_rots
-        //kin::reset_world_basisTrf(pose, pose.world_trfs.at(0));
-        kin::reset_world_basisTrf(pose, pose.get_projected_root_trf());
-
-        poses.push_back(std::move(pose));
+        poses.push_back(kinpose(kmodel, motion.poses.at(i).root_position, local_rots));
     }
     
     return poses;
@@ -114,6 +116,7 @@ spKinMotion kinmotion(const spKinModel& kmodel,
         kmotion->motion_names.push_back(motions.at(i).name);
         kmotion->fbx_start_times.push_back(motions.at(i).start_time);
         kmotion->fbx_end_times.push_back(motions.at(i).end_time);
+        kmotion->fps.push_back(motions.at(i).fps);
     }
     kmotion->motion_n = nom;
     
@@ -277,7 +280,8 @@ int get_pidx(const spKinMotion& kmotion, int mid, float time)
     assert(time >= start_time);
     assert(time < end_time);
 
-    return start_pidx + std::round(60.0f * (time - start_time));
+    float fps = (mid < (int)kmotion->fps.size()) ? kmotion->fps.at(mid) : 60.0f;
+    return start_pidx + std::round(fps * (time - start_time));
 }
 
 }
@@ -11,7 +11,8 @@ Mesh::Mesh(const a::gl::core::spMeshGL meshGL):
     m_joints(),
     m_jnt_name_to_idx(),
     m_buffer(),
-    m_jnt_buffer_idx()
+    m_jnt_buffer_idx(),
+    m_skinned_bounds()
 {}
 
 Mesh::Mesh(std::vector<spJoint>& joints, const a::gl::core::spMeshGL meshGL):
@@ -21,7 +22,8 @@ Mesh::Mesh(std::vector<spJoint>& joints, const a::gl::core::spMeshGL meshGL):
     m_joints(joints),
     m_jnt_name_to_idx(a::gl::joints_name_to_idx_map(joints)),
     m_buffer(),
-    m_jnt_buffer_idx()
+    m_jnt_buffer_idx(),
+    m_skinned_bounds()
 {
     assert(meshGL->is_skinned);
     
@@ -41,7 +43,8 @@ Mesh::Mesh(const Mesh& other):
     m_joints(),
     m_jnt_name_to_idx(),
     m_buffer(),
-    m_jnt_buffer_idx()
+    m_jnt_buffer_idx(),
+    m_skinned_bounds()
 {}
 
 Mesh::Mesh(std::vector<spJoint>& joints, const Mesh& other):
@@ -51,7 +54,8 @@ Mesh::Mesh(std::vector<spJoint>& joints, const Mesh& other):
     m_joints(joints),
     m_jnt_name_to_idx(other.m_jnt_name_to_idx),
     m_buffer(other.m_buffer),
-    m_jnt_buffer_idx(other.m_jnt_buffer_idx)
+    m_jnt_buffer_idx(other.m_jnt_buffer_idx),
+    m_skinned_bounds(other.m_skinned_bounds)
 {
     assert(other.m_meshGL->is_skinned);
     assert(joints.size() == other.m_joints.size());
@@ -79,13 +83,26 @@ void Mesh::update_mesh()
     m_buffer.clear();
     m_buffer.resize(jnt_order.size(), glm::mat4(1.0f));
 
+    // bounds from the joint positions
+    a::gl::core::Bounds bounds;
+
     for(int i = 0; i < jnt_order.size(); ++i)
     {
         int jidx = jnt_order.at(i);
         glm::mat4 wtrf = a::gl::to_glm(m_joints.at(jidx)->world_trf());
         const glm::mat4& btrf_inv = m_meshGL->jonit_bind_trf_inv.at(i);
         m_buffer.at(i) = wtrf * btrf_inv;
+        bounds.expand(glm::vec3(wtrf[3]));
+    }
+
+    if(bounds.valid())
+    {
+        glm::vec3 margin(m_meshGL->skin_radius);
+        bounds.min -= margin;
+        bounds.max += margin;
+        bounds.finalize();
     }
+    m_skinned_bounds = bounds;
 }
 
 int Mesh::vertex_num() const
@@ -98,4 +115,11 @@ bool Mesh::use_skinning() const
     return m_use_skinning;
 }
 
+const a::gl::core::Bounds& Mesh::bounds() const
+{
+    if(m_use_skinning)
+        return m_skinned_bounds;
+    return m_meshGL->vao.bounds;
+}
+
 }
\ No newline at end of file
@@ -0,0 +1,146 @@
+#include "aOpenGL/motionclip.h"
+#include "aOpenGL/jobs.h"
+#include "fbx/keyframe.h"
+#include <iostream>
+
+namespace a::gl {
+
+MotionClip::MotionClip(std::shared_ptr<const SceneKeyFrames> scene, const std::vector<std::string>& joint_names)
+    : m_scene(scene)
+{
+    std::map<std::string, int> name_to_nodeidx;
+    for(int i = 0; i < (int)m_scene->node_keyframes.size(); ++i)
+        name_to_nodeidx[m_scene->node_keyframes[i]->name] = i;
+
+    m_node_idxes.reserve(joint_names.size());
+    for(const auto& name : joint_names)
+    {
+        auto iter = name_to_nodeidx.find(name);
+        if(iter == name_to_nodeidx.end())
+        {
+            m_node_idxes.push_back(-1);
+            std::cout << __FILE__ << "(" << __LINE__ << "): " << name << " not found." << std::endl;
+        }
+        else
+            m_node_idxes.push_back(iter->second);
+    }
+}
+
+const std::string& MotionClip::name() const
+{
+    return m_scene->name;
+}
+
+float MotionClip::start_time() const
+{
+    return m_scene->start_time;
+}
+
+float MotionClip::end_time() const
+{
+    return m_scene->end_time;
+}
+
+float MotionClip::source_fps() const
+{
+    return m_scene->frame_rate;
+}
+
+void MotionClip::sample_joint(int j, const std::vector<float>& times, std::vector<Pose>& poses) const
+{
+    int n = times.size();
+    int idx = m_node_idxes[j];
+    if(idx < 0)
+    {
+        for(int f = 0; f < n; ++f)
+            poses[f].local_rotations[j] = Quat::Identity();
+        return;
+    }
+
+    const NodeKeyFrames& node = *m_scene->node_keyframes[idx];
+    std::vector<float> euler((size_t)n * 3);
+    for(int k = 0; k < 3; ++k)
+        keyframe::sample(node.euler[k], times.data(), n, euler.data() + (size_t)k * n);
+
+    std::vector<glm::quat> rotations(n);
+    keyframe::to_quaternions(euler.data(), euler.data() + n, euler.data() + 2 * n, node.euler_order, n, rotations.data());
+    for(int f = 0; f < n; ++f)
+        poses[f].local_rotations[j] = to_eigen(rotations[f]);
+}
+
+void MotionClip::sample_root(const std::vector<float>& times, std::vector<Pose>& poses) const
+{
+    int n = times.size();
+    int idx = m_node_idxes.empty() ? -1 : m_node_idxes[0];
+    if(idx < 0)
+    {
+        for(int f = 0; f < n; ++f)
+            poses[f].root_position = Vec3::Zero();
+        return;
+    }
+
+    // channels without keys are sampled as 0
+    const NodeKeyFrames& node = *m_scene->node_keyframes[idx];
+    std::vector<float> pos(n);
+    for(int k = 0; k < 3; ++k)
+    {
+        keyframe::sample(node.pos[k], times.data(), n, pos.data());
+        for(int f = 0; f < n; ++f)
+            poses[f].root_position[k] = pos[f];
+    }
+}
+
+Pose MotionClip::pose(float time) const
+{
+    std::vector<float> times(1, time);
+    std::vector<Pose> poses(1);
+    poses[0].local_rotations.resize(joint_num());
+    for(int j = 0; j < joint_num(); ++j)
+        sample_joint(j, times, poses);
+    sample_root(times, poses);
+    return poses[0];
+}
+
+std::vector<Pose> MotionClip::poses(const std::vector<float>& times, bool parallel) const
+{
+    std::vector<Pose> poses(times.size());
+    for(auto& p : poses)
+        p.local_rotations.resize(joint_num());
+
+    // each job writes a different joint of every pose
+    if(parallel)
+    {
+        JobSystem::parallel_for(joint_num(), [&](int j){
+            sample_joint(j, times, poses);
+        });
+    }
+    else
+    {
+        for(int j = 0; j < joint_num(); ++j)
+            sample_joint(j, times, poses);
+    }
+    sample_root(times, poses);
+    return poses;
+}
+
+Motion MotionClip::motion(float fps, bool parallel) const
+{
+    if(fps <= 0.0f)
+        fps = (source_fps() > 0.0f) ? source_fps() : 60.0f;
+
+    float dt = 1.0f / fps;
+    int nof = (int)((end_time() - start_time()) / dt + 1e-4f) + 1;
+    std::vector<float> times(nof);
+    for(int i = 0; i < nof; ++i)
+        times[i] = i * dt + start_time();
+
+    Motion m;
+    m.name = name();
+    m.start_time = start_time();
+    m.end_time = end_time();
+    m.fps = fps;
+    m.poses = poses(times, parallel);
+    return m;
+}
+
+}
\ No newline at end of file
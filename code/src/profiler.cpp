@@ -0,0 +1,415 @@
+#include "aOpenGL/profiler.h"
+#include "aOpenGL/render.h"
+#include "aOpenGL/config.h"
+#include "aOpenGL/core/shader.h"
+
+#include <glad/glad.h>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <thread>
+#include <unordered_map>
+
+namespace a::gl {
+
+bool               Profiler::s_enabled{false};
+bool               Profiler::s_overlay{false};
+Profiler::Counters Profiler::s_counters;
+Profiler::Counters Profiler::s_last_counters;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Event
+{
+    const char* name;
+    double      begin_us;
+    double      dur_us;
+};
+
+// GL_TIME_ELAPSED queries of one frame. read back AGL_PROFILER_QUERY_FRAMES frames later.
+struct FrameQueries
+{
+    std::vector<GLuint>      pool;
+    std::vector<const char*> names;
+    std::vector<double>      begin_us;
+    int                      used{0};
+};
+
+// rolling window per scope name
+struct NameStat
+{
+    const char*         name;
+    std::vector<double> cpu, gpu, calls;
+    double              cpu_frame{0}, gpu_frame{0}, calls_frame{0};
+    bool                gpu_seen{false};
+};
+
+struct TraceEvent
+{
+    const char*        name;
+    double             ts_us, dur_us;
+    int                tid;           // 0: cpu, 1: gpu, -1: counters
+    Profiler::Counters counters;
+};
+
+struct State
+{
+    std::thread::id main_thread;
+    Clock::time_point origin{Clock::now()};
+    double frame_begin_us{-1.0};
+
+    std::vector<Event> events;    // current frame
+    bool gpu_active{false};
+
+    std::vector<NameStat> names;
+    std::unordered_map<const char*, int> name_ptr;   // fast path (string literal)
+    std::unordered_map<std::string, int> name_str;
+
+    std::vector<double> frame_ms = std::vector<double>(AGL_PROFILER_WINDOW, 0.0);
+    int window{0};
+    int window_filled{0};
+
+    FrameQueries queries[AGL_PROFILER_QUERY_FRAMES];
+    int query_slot{0};
+
+    std::vector<TraceEvent> trace;
+    int trace_frames{0};
+    std::string trace_path;
+
+    // overlay text, refreshed a few times per second
+    std::string overlay;
+    double overlay_us{-1e9};
+};
+
+State& state()
+{
+    static State* s = new State;
+    return *s;
+}
+
+double now_us()
+{
+    return std::chrono::duration<double, std::micro>(Clock::now() - state().origin).count();
+}
+
+int name_index(const char* name)
+{
+    auto& s = state();
+    auto it = s.name_ptr.find(name);
+    if(it != s.name_ptr.end())
+        return it->second;
+
+    // same name from another translation unit
+    auto it2 = s.name_str.find(name);
+    int idx;
+    if(it2 != s.name_str.end())
+        idx = it2->second;
+    else
+    {
+        idx = (int)s.names.size();
+        NameStat stat;
+        stat.name = name;
+        stat.cpu.assign(AGL_PROFILER_WINDOW, 0.0);
+        stat.gpu.assign(AGL_PROFILER_WINDOW, 0.0);
+        stat.calls.assign(AGL_PROFILER_WINDOW, 0.0);
+        s.names.push_back(stat);
+        s.name_str[name] = idx;
+    }
+    s.name_ptr[name] = idx;
+    return idx;
+}
+
+void resolve_queries(FrameQueries& fq)
+{
+    auto& s = state();
+    for(int i = 0; i < fq.used; ++i)
+    {
+        GLint available = 0;
+        glGetQueryObjectiv(fq.pool[i], GL_QUERY_RESULT_AVAILABLE, &available);
+        if(available == 0)
+            continue; // never wait for the GPU
+
+        GLuint64 ns = 0;
+        glGetQueryObjectui64v(fq.pool[i], GL_QUERY_RESULT, &ns);
+        double ms = ns * 1e-6;
+
+        auto& stat = s.names[name_index(fq.names[i])];
+        stat.gpu_frame += ms;
+        stat.gpu_seen = true;
+
+        if(s.trace_frames > 0)
+            s.trace.push_back(TraceEvent{fq.names[i], fq.begin_us[i], ms * 1e3, 1, {}});
+    }
+    fq.used = 0;
+    fq.names.clear();
+    fq.begin_us.clear();
+}
+
+double window_average(const std::vector<double>& values, int filled)
+{
+    if(filled == 0)
+        return 0.0;
+    double sum = 0.0;
+    for(int i = 0; i < filled; ++i)
+        sum += values[i];
+    return sum / filled;
+}
+
+}
+
+Profiler::Scope::Scope(const char* name, bool gpu)
+{
+    if(s_enabled == false)
+        return;
+
+    auto& s = state();
+    if(std::this_thread::get_id() != s.main_thread)
+        return;
+
+    m_event = (int)s.events.size();
+    s.events.push_back(Event{name, now_us(), 0.0});
+
+    if(gpu && s.gpu_active == false)
+    {
+        auto& fq = s.queries[s.query_slot];
+        if(fq.used == (int)fq.pool.size())
+        {
+            GLuint query;
+            glGenQueries(1, &query);
+            fq.pool.push_back(query);
+        }
+        glBeginQuery(GL_TIME_ELAPSED, fq.pool[fq.used]);
+        fq.names.push_back(name);
+        fq.begin_us.push_back(s.events.back().begin_us);
+        fq.used++;
+
+        s.gpu_active = true;
+        m_gpu = true;
+    }
+}
+
+Profiler::Scope::~Scope()
+{
+    if(m_event < 0)
+        return;
+
+    auto& s = state();
+    if(m_gpu)
+    {
+        glEndQuery(GL_TIME_ELAPSED);
+        s.gpu_active = false;
+    }
+
+    // events are cleared only at frame boundaries, where no scope is open
+    if(m_event >= (int)s.events.size())
+        return;
+
+    auto& e = s.events[m_event];
+    e.dur_us = now_us() - e.begin_us;
+
+    auto& stat = s.names[name_index(e.name)];
+    stat.cpu_frame += e.dur_us * 1e-3;
+    stat.calls_frame += 1.0;
+}
+
+void Profiler::set_enabled(bool set)
+{
+    s_enabled = set;
+    state().frame_begin_us = -1.0;
+}
+
+void Profiler::begin_frame()
+{
+    auto& s = state();
+    s.main_thread = std::this_thread::get_id();
+    s.events.clear();
+
+    if(s_enabled == false)
+        return;
+
+    double now = now_us();
+    if(s.frame_begin_us >= 0.0)
+        s.frame_ms[s.window] = (now - s.frame_begin_us) * 1e-3;
+    s.frame_begin_us = now;
+
+    // queries issued AGL_PROFILER_QUERY_FRAMES frames ago
+    s.query_slot = (s.query_slot + 1) % AGL_PROFILER_QUERY_FRAMES;
+    resolve_queries(s.queries[s.query_slot]);
+}
+
+void Profiler::end_frame()
+{
+    s_last_counters = s_counters;
+    s_counters = Counters();
+
+    if(s_enabled == false)
+        return;
+
+    auto& s = state();
+    for(auto& stat : s.names)
+    {
+        stat.cpu[s.window]   = stat.cpu_frame;
+        stat.gpu[s.window]   = stat.gpu_frame;
+        stat.calls[s.window] = stat.calls_frame;
+        stat.cpu_frame = stat.gpu_frame = stat.calls_frame = 0.0;
+    }
+    s.window = (s.window + 1) % AGL_PROFILER_WINDOW;
+    s.window_filled = std::min(s.window_filled + 1, AGL_PROFILER_WINDOW);
+
+    if(s.trace_frames > 0)
+    {
+        for(const auto& e : s.events)
+            s.trace.push_back(TraceEvent{e.name, e.begin_us, e.dur_us, 0, {}});
+        s.trace.push_back(TraceEvent{"counters", s.frame_begin_us, 0.0, -1, s_last_counters});
+        s.trace_frames--;
+
+        if(s.trace_frames == 0 && s.trace_path.empty() == false)
+        {
+            if(save_trace(s.trace_path))
+                std::cout << "Profiler: trace saved to " << s.trace_path << std::endl;
+            s.trace_path.clear();
+        }
+    }
+}
+
+double Profiler::frame_ms()
+{
+    auto& s = state();
+    return window_average(s.frame_ms, s.window_filled);
+}
+
+std::vector<Profiler::Stat> Profiler::stats()
+{
+    auto& s = state();
+    std::vector<Stat> result;
+    result.reserve(s.names.size());
+    for(const auto& stat : s.names)
+    {
+        double gpu = stat.gpu_seen ? window_average(stat.gpu, s.window_filled) : -1.0;
+        result.push_back(Stat{stat.name, window_average(stat.cpu, s.window_filled), gpu, window_average(stat.calls, s.window_filled)});
+    }
+    return result;
+}
+
+void Profiler::start_trace(int frame_num, const std::string& path)
+{
+    auto& s = state();
+    s.trace.clear();
+    s.trace_frames = frame_num;
+    s.trace_path = path;
+}
+
+bool Profiler::tracing()
+{
+    return state().trace_frames > 0;
+}
+
+bool Profiler::save_trace(const std::string& path)
+{
+    std::ofstream file(path);
+    if(file.is_open() == false)
+        return false;
+
+    auto escape = [](const char* str)
+    {
+        std::string out;
+        for(const char* c = str; *c; ++c)
+        {
+            if(*c == '"' || *c == '\\')
+                out += '\\';
+            out += *c;
+        }
+        return out;
+    };
+
+    file << std::fixed << std::setprecision(3);
+    file << "{\"traceEvents\":[\n";
+    file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":0,\"args\":{\"name\":\"CPU\"}},\n";
+    file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":1,\"args\":{\"name\":\"GPU\"}}";
+    for(const auto& e : state().trace)
+    {
+        file << ",\n";
+        if(e.tid < 0)
+        {
+            file << "{\"name\":\"counters\",\"ph\":\"C\",\"pid\":0,\"ts\":" << e.ts_us
+                 << ",\"args\":{\"draw_calls\":" << e.counters.draw_calls
+                 << ",\"uniform_uploads\":" << e.counters.uniform_uploads
+                 << ",\"texture_binds\":" << e.counters.texture_binds
+                 << ",\"triangles\":" << e.counters.triangles << "}}";
+        }
+        else
+        {
+            // gpu events start at the cpu time of the scope. only the duration is measured.
+            file << "{\"name\":\"" << escape(e.name) << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << e.tid
+                 << ",\"ts\":" << e.ts_us << ",\"dur\":" << e.dur_us << "}";
+        }
+    }
+    file << "\n],\"displayTimeUnit\":\"ms\"}\n";
+    return file.good();
+}
+
+void Profiler::draw_overlay(int width, int height)
+{
+    if(s_enabled == false || s_overlay == false || Render::font_texture == nullptr)
+        return;
+
+    auto& s = state();
+
+    // rebuilding the text every frame would churn the layout cache
+    double now = now_us();
+    if(now - s.overlay_us > 250e3)
+    {
+        s.overlay_us = now;
+
+        std::ostringstream out;
+        out << std::fixed << std::setprecision(2);
+        double ms = frame_ms();
+        out << "frame " << ms << " ms (" << std::setprecision(0) << (ms > 0.0 ? 1000.0 / ms : 0.0) << " fps)\n";
+        out << "draws " << s_last_counters.draw_calls << "  tris " << s_last_counters.triangles
+            << "  uniforms " << s_last_counters.uniform_uploads << "  textures " << s_last_counters.texture_binds << "\n";
+        out << std::setprecision(2);
+        for(const auto& stat : stats())
+        {
+            out << stat.name << "  cpu " << stat.cpu_ms;
+            if(stat.gpu_ms >= 0.0)
+                out << "  gpu " << stat.gpu_ms;
+            out << "  x" << std::setprecision(0) << stat.calls << std::setprecision(2) << "\n";
+        }
+        s.overlay = out.str();
+    }
+
+    const auto& layout = Render::font_texture->layout(s.overlay, 1.2f);
+    if(layout.vertex_num == 0)
+        return;
+
+    float px = AGL_PROFILER_FONT_SIZE;
+    float scale = px / AGL_FONT_RESOLUTION;
+
+    // screen space: pixels, origin at the bottom-left
+    auto shader = Render::text_shader;
+    shader->use();
+    shader->setMat4("u_projection", glm::ortho(0.0f, (float)width, 0.0f, (float)height, -1.0f, 1.0f));
+    shader->setMat4("u_view", glm::mat4(1.0f));
+    shader->setMat4("u_model", glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(10.0f, height - 10.0f - px, 0.0f)), glm::vec3(scale, scale, 1.0f)));
+    shader->setVec3("u_textColor", glm::vec3(1.0f, 1.0f, 0.0f));
+    shader->view_update(false);
+
+    GLboolean depth_test = glIsEnabled(GL_DEPTH_TEST);
+    glDisable(GL_DEPTH_TEST);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, Render::font_texture->texture());
+    glBindVertexArray(layout.vao);
+    glDrawArrays(GL_TRIANGLES, 0, layout.vertex_num);
+    glBindVertexArray(0);
+    if(depth_test)
+        glEnable(GL_DEPTH_TEST);
+}
+
+}
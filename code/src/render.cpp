@@ -10,8 +10,12 @@
 #include "aOpenGL/renderoption.h"
 #include "aOpenGL/core/primitive.h"
 #include "aOpenGL/config.h"
+#include "aOpenGL/profiler.h"
 
 #include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
 
 namespace a::gl {
 
@@ -24,19 +28,32 @@ core::Shader* Render::lbs_shader;
 core::Shader* Render::shadow_shader;
 core::Shader* Render::text_shader;
 
-core::Shader* Render::alpha_primitive_shader;
-core::Shader* Render::alpha_lbs_shader;
 
 FontTexture* Render::font_texture;
 
+// render target
+unsigned int Render::main_fbo{0};
+
 // shadows
 unsigned int Render::depth_map_fbo;
 unsigned int Render::depth_map_handle;
+unsigned int Render::cascade_map_fbo;
+unsigned int Render::cascade_map_handle;
 
 // environment
 core::Shader* Render::tocube_shader;
 core::Shader* Render::background_shader;
 
+// instanced primitives
+static const int primitive_num = (int)Render::Primitive::ARROW + 1;
+struct InstanceBatch
+{
+    core::VAO                     mesh;     // shared vertex data
+    core::VAO                     vao{0, 0, 0, 0};
+    GLuint                        vbo{0};
+    std::vector<core::InstanceGL> instances;
+};
+
 // app render info
 struct Render::AppRenderInfo
 {
@@ -47,6 +64,54 @@ struct Render::AppRenderInfo
     glm::vec3 light_direction{0.25f, 1.0f, 0.5f};
     glm::vec3 light_color{50.0f, 50.0f, 50.0f};
     glm::mat4 light_space;
+
+    // cascaded shadow maps
+    int       cascade_num{0};
+    int       cascade_size{AGL_SHADOW_CASCADE_SIZE};
+    float     shadow_distance{AGL_SHADOW_DISTANCE};
+    glm::mat4 cascade_space[AGL_MAX_SHADOW_CASCADES];
+    glm::vec4 cascade_splits;  // far distance of each cascade in view space
+    glm::mat4 shadow_space;    // light space of the current shadow pass
+
+    // static caster cache (one per shadow pass)
+    enum class ShadowStage{NONE, ALL, STATIC, DYNAMIC, DYNAMIC_ONLY};
+    struct CasterRecord
+    {
+        GLuint vao{0};
+        size_t hash{0};          // transform of the last frame
+        bool   dynamic{false};   // moved. drawn with the dynamic casters
+        int    still_frames{0};
+    };
+    struct ShadowCache
+    {
+        GLuint    fbo{0}, handle{0};
+        int       size{0};
+        bool      valid{false};
+        size_t    hash{0};
+        glm::mat4 space{0.0f};   // light space of the last frame
+        int       misses{0};     // consecutive frames the static casters were redrawn
+        int       bypass{0};     // frames left to draw without the cache
+        std::vector<CasterRecord> casters;  // static casters in draw order
+    };
+    bool        use_shadow_cache{AGL_SHADOW_STATIC_CACHE != 0};
+    ShadowCache shadow_cache[AGL_MAX_SHADOW_CASCADES];
+    ShadowStage shadow_stage{ShadowStage::NONE};
+    size_t      static_hash{0};
+    int         shadow_idx{0};
+    int         caster_idx{0};      // static caster counter of the current stage
+    bool        casters_tracked{false};
+
+    // culling
+    bool            use_frustum_cull{true};
+    core::Frustum   cam_frustum;
+    core::Frustum   light_frustum;
+    CullStats       cull_stats[2];
+
+    // transparent objects of the current pass
+    std::vector<spRenderOptions> transparent_queue;
+
+    // instanced primitives of the current pass. [type][debug]
+    InstanceBatch batches[primitive_num][2];
 };
 std::shared_ptr<Render::AppRenderInfo> Render::app_render_info;
 
@@ -58,14 +123,27 @@ static std::string absolute_path(const char* path)
     return agl_path + std::string(path);
 }
 
+/**
+ * @brief dequantization uniforms of core::PackedVertexGL
+ */
+static void set_vertex_layout(const core::VAO& vao, core::Shader* shader)
+{
+    shader->setBool("u_packed", vao.packed);
+    if(vao.packed)
+    {
+        shader->setVec3("u_position_offset", vao.position_offset);
+        shader->setVec3("u_position_scale", vao.position_scale);
+    }
+}
+
 #define AGL_RETURN_PBR_RENDER_OPTIONS(PRIMITIVE) \
     if(render_type == Render::RenderMode::SHADOW) { \
         return std::make_shared<RenderOptions>( \
-            RenderOptions(PRIMITIVE, Render::shadow_shader, nullptr, Render::draw_shadow)); \
+            RenderOptions(PRIMITIVE, Render::shadow_shader, Render::draw_shadow)); \
     } \
     else { \
         return std::make_shared<RenderOptions>( \
-            RenderOptions(PRIMITIVE, Render::primitive_shader, Render::alpha_primitive_shader, Render::draw_pbr)); \
+            RenderOptions(PRIMITIVE, Render::primitive_shader, Render::draw_pbr)); \
     }
 
 spRenderOptions Render::cube()
@@ -117,13 +195,13 @@ spRenderOptions Render::text(const std::string& text, float line_space)
     if(render_type == Render::RenderMode::SHADOW)
     {
         ro = std::make_shared<RenderOptions>(
-            RenderOptions(core::VAO(), nullptr, nullptr, Render::draw_pbr)
+            RenderOptions(core::VAO(), nullptr, Render::draw_pbr)
         );
     }
     else
     {
         ro = std::make_shared<RenderOptions>(
-            RenderOptions(core::VAO(), Render::text_shader, Render::text_shader, Render::draw_text)
+            RenderOptions(core::VAO(), Render::text_shader, Render::draw_text)
         );
         
         ro->m_text = text;
@@ -143,37 +221,43 @@ spRenderOptions Render::mesh(spMesh m)
         if(render_type == Render::RenderMode::SHADOW)
         {
             ro = std::make_shared<RenderOptions>(
-                RenderOptions(m->m_meshGL->vao, Render::shadow_shader, nullptr, Render::draw_shadow)
+                RenderOptions(m->m_meshGL->vao, Render::shadow_shader, Render::draw_shadow)
             );
         }
         else
         {
             ro = std::make_shared<RenderOptions>(
-                RenderOptions(m->m_meshGL->vao, Render::lbs_shader, Render::alpha_lbs_shader, Render::draw_pbr)
+                RenderOptions(m->m_meshGL->vao, Render::lbs_shader, Render::draw_pbr)
             );
         }
         
         // set buffer
         ro->m_use_skinning = true;
         ro->m_buffer_transforms = m->m_buffer;
+
+        // skinned bounds are in world space
+        ro->m_bounds = m->m_skinned_bounds;
+        ro->m_world_bounds = true;
+        ro->m_static_caster = false;
     }
     else
     {
         if(render_type == Render::RenderMode::SHADOW)
         {
             ro = std::make_shared<RenderOptions>(
-                RenderOptions(m->m_meshGL->vao, Render::shadow_shader, nullptr, Render::draw_shadow)
+                RenderOptions(m->m_meshGL->vao, Render::shadow_shader, Render::draw_shadow)
             );
         }
         else
         {
             ro = std::make_shared<RenderOptions>(
-                RenderOptions(m->m_meshGL->vao, Render::primitive_shader, Render::alpha_primitive_shader, Render::draw_pbr)
+                RenderOptions(m->m_meshGL->vao, Render::primitive_shader, Render::draw_pbr)
             );
         }
     }
     
     ro->m_materials = m->m_materials;
+    ro->update_transparent();
     return ro;
 }
 
@@ -217,6 +301,107 @@ spRenderOptionsVec Render::skeleton(spModel model)
     return options;
 }
 
+void Render::batch(Primitive type, const glm::mat4& model, const glm::vec3& color, bool debug)
+{
+    using Stage = AppRenderInfo::ShadowStage;
+    auto& info = *app_render_info;
+    bool shadow = (render_type == Render::RenderMode::SHADOW);
+
+    // instances are dynamic casters
+    if(shadow && info.shadow_stage == Stage::STATIC)
+        return;
+
+    InstanceBatch& batch = info.batches[(int)type][debug ? 1 : 0];
+    if(batch.mesh.vao == 0)
+    {
+        switch(type)
+        {
+        case Primitive::CUBE:     batch.mesh = core::VAOPrimitive::cube();     break;
+        case Primitive::SPHERE:   batch.mesh = core::VAOPrimitive::sphere();   break;
+        case Primitive::PLANE:    batch.mesh = core::VAOPrimitive::plane();    break;
+        case Primitive::CYLINDER: batch.mesh = core::VAOPrimitive::cylinder(); break;
+        case Primitive::CONE:     batch.mesh = core::VAOPrimitive::cone();     break;
+        case Primitive::PYRAMID:  batch.mesh = core::VAOPrimitive::pyramid();  break;
+        case Primitive::ARROW:    batch.mesh = Render::arrow()->m_vao;         break;
+        }
+    }
+
+    CullStats& stats = info.cull_stats[(int)render_type];
+    if(info.use_frustum_cull)
+    {
+        const core::Frustum& frustum = shadow ? info.light_frustum : info.cam_frustum;
+        if(frustum.intersects(batch.mesh.bounds, model) == false)
+        {
+            stats.culled++;
+            return;
+        }
+    }
+    stats.submitted++;
+    batch.instances.push_back({model, glm::vec4(color, 1.0f)});
+}
+
+void Render::batch(Primitive type, const Vec3& position, float scale, const Vec3& color, bool debug)
+{
+    glm::mat4 model = glm::translate(glm::mat4(1.0f), to_glm(position)) * 
+                      glm::scale(glm::mat4(1.0f), glm::vec3(scale, scale, scale));
+    Render::batch(type, model, to_glm(color), debug);
+}
+
+void Render::batch(Primitive type, const Mat4& transform, const Vec3& scale, const Vec3& color, bool debug)
+{
+    glm::mat4 model = to_glm(transform) * glm::scale(glm::mat4(1.0f), to_glm(scale));
+    Render::batch(type, model, to_glm(color), debug);
+}
+
+void Render::batch_skeleton(spModel model, const Vec3& color)
+{
+    auto jnts = model->joints();
+    for(auto& jnt : jnts)
+    {
+        if(jnt->parent() == nullptr)
+            continue;
+
+        float scale_y = jnt->skel_length();
+        float scale_xz = 0.1f * scale_y;
+        Render::batch(Primitive::PYRAMID, jnt->skel_world_trf(), Vec3(scale_xz, scale_y, scale_xz), color, true);
+    }
+}
+
+void Render::draw_batch()
+{
+    bool shadow = (render_type == Render::RenderMode::SHADOW);
+    for(auto& batch_type : app_render_info->batches)
+    {
+        for(int debug = 0; debug < 2; ++debug)
+        {
+            InstanceBatch& batch = batch_type[debug];
+            if(batch.instances.empty())
+                continue;
+
+            if(batch.vbo == 0)
+            {
+                glGenBuffers(1, &batch.vbo);
+                batch.vao = core::bind_instanced(batch.mesh, batch.vbo);
+            }
+
+            glBindBuffer(GL_ARRAY_BUFFER, batch.vbo);
+            glBufferData(GL_ARRAY_BUFFER, sizeof(core::InstanceGL) * batch.instances.size(), &batch.instances[0], GL_STREAM_DRAW);
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+            spRenderOptions ro;
+            if(shadow)
+                ro = std::make_shared<RenderOptions>(batch.vao, Render::shadow_shader, Render::draw_shadow);
+            else
+                ro = std::make_shared<RenderOptions>(batch.vao, Render::primitive_shader, Render::draw_pbr);
+            ro->m_instance_num = (int)batch.instances.size();
+            ro->m_debug = (debug == 1);
+            ro->m_fpDraw(ro, ro->m_shader);
+
+            batch.instances.clear();
+        }
+    }
+}
+
 static void generate_shadow_buffer(GLuint& fbo, GLuint& shadow_map, int reolustion)
 {
     // configure depth map FBO
@@ -245,8 +430,38 @@ static void generate_shadow_buffer(GLuint& fbo, GLuint& shadow_map, int reolusti
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
 }
 
+static void generate_cascade_buffer(GLuint& fbo, GLuint& cascade_map, int num, int resolution)
+{
+    glGenFramebuffers(1, &fbo);
+
+    // one layer per cascade
+    glGenTextures(1, &cascade_map);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, cascade_map);
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT, resolution, resolution, num, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+
+    float borderColor[] = { 1.0, 1.0, 1.0, 1.0 };
+    glTexParameterfv(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BORDER_COLOR, borderColor);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+    // layer is attached in set_shadow_pass()
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, cascade_map, 0, 0);
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
 void Render::initialize_shaders()
 {
+    auto begin = std::chrono::steady_clock::now();
+    if(std::string(AGL_SHADER_CACHE_DIR).empty() == false)
+        core::Shader::set_cache_dir(absolute_path(AGL_SHADER_CACHE_DIR));
+
     // pbr shader initialize
     Render::primitive_shader 
         = new core::Shader(absolute_path(AGL_PBR_VS), absolute_path(AGL_PBR_FS));
@@ -257,16 +472,6 @@ void Render::initialize_shaders()
         = new core::Shader(absolute_path(AGL_LBS_PBR_VS), absolute_path(AGL_PBR_FS));
     Render::lbs_shader->build();
 
-    // pbr shader initialize
-    Render::alpha_primitive_shader 
-        = new core::Shader(absolute_path(AGL_PBR_VS), absolute_path(AGL_EMPTY_FS));
-    Render::alpha_primitive_shader->build();
-
-    // lbs shader initialize
-    Render::alpha_lbs_shader 
-        = new core::Shader(absolute_path(AGL_LBS_PBR_VS), absolute_path(AGL_EMPTY_FS));
-    Render::alpha_lbs_shader->build();
-
     // text shader initialize
     Render::text_shader 
         = new core::Shader(absolute_path(AGL_TEXT_VS), absolute_path(AGL_TEXT_FS));
@@ -289,8 +494,79 @@ void Render::initialize_shaders()
     Render::shadow_shader->build();
     generate_shadow_buffer(Render::depth_map_fbo, Render::depth_map_handle, AGL_SHADOW_MAP_SIZE);
 
+    // cold (compile) vs. warm (binary cache) startup
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+    std::cout << "Render::initialize_shaders: " << ms << " ms (program binary cache: " 
+              << core::Shader::cache_hits() << " loaded, " << core::Shader::cache_misses() << " compiled)" << std::endl;
+
     // set app render info
     app_render_info = std::make_shared<AppRenderInfo>();
+    Render::set_shadow_cascades(AGL_SHADOW_CASCADES);
+}
+
+void Render::set_shadow_cascades(int num)
+{
+    Render::set_shadow_cascades(num, AGL_SHADOW_CASCADE_SIZE, AGL_SHADOW_DISTANCE);
+}
+
+void Render::set_shadow_cascades(int num, int resolution, float distance)
+{
+    num = std::max(0, std::min(num, AGL_MAX_SHADOW_CASCADES));
+
+    if(Render::cascade_map_handle)
+    {
+        glDeleteTextures(1, &Render::cascade_map_handle);
+        glDeleteFramebuffers(1, &Render::cascade_map_fbo);
+        Render::cascade_map_handle = 0;
+        Render::cascade_map_fbo = 0;
+    }
+    if(num > 0)
+        generate_cascade_buffer(Render::cascade_map_fbo, Render::cascade_map_handle, num, resolution);
+
+    app_render_info->cascade_num = num;
+    app_render_info->cascade_size = resolution;
+    app_render_info->shadow_distance = distance;
+
+    // sizes of the passes are changed
+    Render::set_shadow_cache(app_render_info->use_shadow_cache);
+}
+
+void Render::set_shadow_cache(bool use_cache)
+{
+    for(auto& cache : app_render_info->shadow_cache)
+    {
+        if(cache.handle)
+        {
+            glDeleteTextures(1, &cache.handle);
+            glDeleteFramebuffers(1, &cache.fbo);
+        }
+        cache = AppRenderInfo::ShadowCache();
+    }
+    app_render_info->use_shadow_cache = use_cache;
+}
+
+int Render::shadow_pass_num()
+{
+    return std::max(1, app_render_info->cascade_num);
+}
+
+int Render::set_shadow_pass(int idx)
+{
+    app_render_info->shadow_stage = AppRenderInfo::ShadowStage::NONE;
+
+    if(app_render_info->cascade_num == 0)
+    {
+        glBindFramebuffer(GL_FRAMEBUFFER, Render::depth_map_fbo);
+        app_render_info->shadow_space = app_render_info->light_space;
+        app_render_info->light_frustum = core::Frustum(app_render_info->light_space);
+        return AGL_SHADOW_MAP_SIZE;
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, Render::cascade_map_fbo);
+    glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, Render::cascade_map_handle, 0, idx);
+    app_render_info->shadow_space = app_render_info->cascade_space[idx];
+    app_render_info->light_frustum = core::Frustum(app_render_info->cascade_space[idx]);
+    return app_render_info->cascade_size;
 }
 
 void Render::set_render_mode(Render::RenderMode type, int width, int height)
@@ -301,7 +577,7 @@ void Render::set_render_mode(Render::RenderMode type, int width, int height)
     }
     else
     {
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glBindFramebuffer(GL_FRAMEBUFFER, Render::main_fbo);
     }
     
     Render::render_type = type;
@@ -322,6 +598,383 @@ void Render::set_sky_color(Vec3 rgb)
     Render::app_render_info->sky_color = glm::vec4(to_glm(rgb), 1.0f);
 }
 
+static void hash_combine(size_t& seed, const void* data, size_t bytes)
+{
+    // FNV-1a
+    const unsigned char* p = (const unsigned char*)data;
+    for(size_t i = 0; i < bytes; ++i)
+    {
+        seed ^= p[i];
+        seed *= 1099511628211ull;
+    }
+}
+
+// a caster that moves is drawn as dynamic. it becomes static again after it stays still for this many frames
+static const int kShadowPromoteFrames = 120;
+
+// the cache is not used for a while after this many misses in a row
+static const int kShadowMaxMisses   = 4;
+static const int kShadowBypassFrames = 60;
+
+bool Render::next_shadow_stage(int idx)
+{
+    using Stage = AppRenderInfo::ShadowStage;
+    auto& info = *app_render_info;
+
+    GLuint target_fbo = (info.cascade_num == 0) ? Render::depth_map_fbo : Render::cascade_map_fbo;
+    int size = (info.cascade_num == 0) ? AGL_SHADOW_MAP_SIZE : info.cascade_size;
+
+    // draw everything
+    auto draw_all = [&]()
+    {
+        if(info.shadow_stage == Stage::NONE)
+        {
+            glClear(GL_DEPTH_BUFFER_BIT);
+            info.shadow_stage = Stage::ALL;
+            return true;
+        }
+        info.shadow_stage = Stage::NONE;
+        return false;
+    };
+    if(info.use_shadow_cache == false)
+        return draw_all();
+
+    AppRenderInfo::ShadowCache& cache = info.shadow_cache[idx];
+    auto begin_stage = [&](Stage stage)
+    {
+        info.shadow_idx = idx;
+        info.caster_idx = 0;
+        info.static_hash = 0;
+        info.shadow_stage = stage;
+    };
+    auto end_tracking = [&]()
+    {
+        // casters that are not drawn anymore
+        if(info.casters_tracked == false)
+            cache.casters.resize(info.caster_idx);
+        info.casters_tracked = true;
+    };
+    auto copy_cache = [&]()
+    {
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, cache.fbo);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, target_fbo);
+        glBlitFramebuffer(0, 0, size, size, 0, 0, size, size, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+        glBindFramebuffer(GL_FRAMEBUFFER, target_fbo);
+    };
+    auto draw_static = [&]()
+    {
+        if(cache.size != size)
+        {
+            if(cache.handle)
+            {
+                glDeleteTextures(1, &cache.handle);
+                glDeleteFramebuffers(1, &cache.fbo);
+            }
+            generate_shadow_buffer(cache.fbo, cache.handle, size);
+            cache.size = size;
+        }
+        glBindFramebuffer(GL_FRAMEBUFFER, cache.fbo);
+        glClear(GL_DEPTH_BUFFER_BIT);
+        begin_stage(Stage::STATIC);
+    };
+    auto miss = [&]()
+    {
+        cache.valid = false;
+        if(++cache.misses >= kShadowMaxMisses)
+            cache.bypass = kShadowBypassFrames;
+    };
+
+    switch(info.shadow_stage)
+    {
+    case Stage::NONE:
+    {
+        info.casters_tracked = false;
+
+        // the light space moves with the camera (cascades). the cache could not be reused.
+        bool space_changed = (cache.space != info.shadow_space);
+        cache.space = info.shadow_space;
+        if(space_changed)
+        {
+            miss();
+            return draw_all();
+        }
+        if(cache.bypass > 0)
+        {
+            // try again with a single miss left
+            if(--cache.bypass == 0)
+                cache.misses = kShadowMaxMisses - 1;
+            return draw_all();
+        }
+
+        if(cache.valid)
+        {
+            // reuse static casters. their hash is checked after the dynamic casters are drawn.
+            copy_cache();
+            begin_stage(Stage::DYNAMIC);
+        }
+        else
+        {
+            draw_static();
+        }
+        return true;
+    }
+
+    case Stage::ALL:
+        return draw_all();
+
+    case Stage::DYNAMIC:
+        end_tracking();
+        if(info.static_hash == cache.hash)
+        {
+            cache.misses = 0;
+            info.shadow_stage = Stage::NONE;
+            return false;
+        }
+        // static casters are changed. moved ones are dynamic from now on
+        miss();
+        draw_static();
+        return true;
+
+    case Stage::STATIC:
+        end_tracking();
+        cache.hash = info.static_hash;
+        cache.valid = true;
+        copy_cache();
+        begin_stage(Stage::DYNAMIC_ONLY);
+        return true;
+
+    default:
+        info.shadow_stage = Stage::NONE;
+        return false;
+    }
+}
+
+bool Render::track_static_caster(RenderOptions* option)
+{
+    // casters are identified by the draw order. render() creates new RenderOptions every frame
+    auto& info = *app_render_info;
+    size_t hash = 14695981039346656037ull;
+    hash_combine(hash, &option->m_position,    sizeof(option->m_position));
+    hash_combine(hash, &option->m_orientation, sizeof(option->m_orientation));
+    hash_combine(hash, &option->m_scale,       sizeof(option->m_scale));
+    if(option->m_use_skinning)
+    {
+        hash_combine(hash, option->m_buffer_transforms.data(), 
+                     sizeof(glm::mat4) * option->m_buffer_transforms.size());
+    }
+
+    auto& casters = info.shadow_cache[info.shadow_idx].casters;
+    int idx = info.caster_idx++;
+    if(idx >= (int)casters.size())
+        casters.resize(idx + 1);
+
+    // records are updated once per frame, by the first stage that sees the casters
+    auto& record = casters[idx];
+    if(info.casters_tracked == false)
+    {
+        if(record.vao != option->m_vao.vao)
+        {
+            // a different caster. draw order is changed
+            record = AppRenderInfo::CasterRecord();
+            record.vao = option->m_vao.vao;
+        }
+        else if(record.hash != hash)
+        {
+            record.dynamic = true;
+            record.still_frames = 0;
+        }
+        else if(record.dynamic && ++record.still_frames >= kShadowPromoteFrames)
+        {
+            record.dynamic = false;
+        }
+        record.hash = hash;
+    }
+
+    if(record.dynamic)
+        return false;
+
+    hash_combine(info.static_hash, &option->m_vao.vao, sizeof(option->m_vao.vao));
+    hash_combine(info.static_hash, &hash, sizeof(hash));
+    return true;
+}
+
+void Render::set_frustum_culling(bool use_cull)
+{
+    Render::app_render_info->use_frustum_cull = use_cull;
+}
+
+Render::CullStats Render::cull_stats(Render::RenderMode mode)
+{
+    return Render::app_render_info->cull_stats[(int)mode];
+}
+
+bool Render::is_culled(RenderOptions* option, bool record)
+{
+    // nothing is drawn without a shader
+    if(option->m_shader == nullptr)
+        return false;
+
+    // static caster cache
+    using Stage = AppRenderInfo::ShadowStage;
+    Stage stage = app_render_info->shadow_stage;
+    if(render_type == Render::RenderMode::SHADOW && stage != Stage::ALL && stage != Stage::NONE)
+    {
+        bool is_static = option->m_static_caster && track_static_caster(option);
+        bool draw = (stage == Stage::STATIC) ? is_static : !is_static;
+        if(draw == false)
+            return true;
+    }
+
+    bool culled = false;
+    if(app_render_info->use_frustum_cull && option->m_frustum_cull && option->m_bounds.valid())
+    {
+        const core::Frustum& frustum = (render_type == Render::RenderMode::SHADOW) ? 
+                                        app_render_info->light_frustum : app_render_info->cam_frustum;
+        if(option->m_world_bounds)
+        {
+            culled = !frustum.intersects(option->m_bounds);
+        }
+        else
+        {
+            glm::mat4 transform = glm::translate(glm::mat4(1.0), option->m_position) * 
+                                  glm::mat4(option->m_orientation) * 
+                                  glm::scale(glm::mat4(1.0), option->m_scale);
+            culled = !frustum.intersects(option->m_bounds, transform);
+        }
+    }
+
+    if(record)
+    {
+        CullStats& stats = app_render_info->cull_stats[(int)render_type];
+        if(culled)
+            stats.culled++;
+        else
+            stats.submitted++;
+    }
+    return culled;
+}
+
+/**
+ * @brief fit an ortho light box to each slice of the camera frustum.
+ *        bounding sphere 를 사용해서 camera 가 회전해도 크기가 변하지 않고, 
+ *        원점을 texel 단위로 snap 해서 camera 가 움직여도 shadow 가 떨리지 않음.
+ */
+static void fit_cascades(Render::AppRenderInfo& info, const Camera& cam, const Light& light, int width, int height)
+{
+    int num = info.cascade_num;
+    float aspect = (float)width / (float)height;
+    bool perspective = cam.is_perspective();
+    float near_plane = perspective ? 0.1f : 0.0f;
+    float far_plane = info.shadow_distance;
+
+    // practical split scheme (log & uniform)
+    const float lambda = perspective ? 0.75f : 0.0f;
+    float splits[AGL_MAX_SHADOW_CASCADES + 1];
+    splits[0] = near_plane;
+    for(int i = 1; i <= num; ++i)
+    {
+        float t = (float)i / num;
+        float log_split = (near_plane > 0.0f) ? near_plane * std::pow(far_plane / near_plane, t) : 0.0f;
+        float uni_split = near_plane + (far_plane - near_plane) * t;
+        splits[i] = lambda * log_split + (1.0f - lambda) * uni_split;
+    }
+
+    glm::mat4 inv_view = glm::inverse(info.cam_view);
+    glm::vec3 light_dir = glm::normalize(light.direction);
+    glm::vec3 up = (std::abs(light_dir.y) > 0.99f) ? glm::vec3(0, 0, 1) : glm::vec3(0, 1, 0);
+    float half_size = 0.00001f * cam.ortho_zoom();
+
+    for(int c = 0; c < num; ++c)
+    {
+        // corners of the slice in world space
+        glm::vec3 corners[8];
+        for(int k = 0; k < 2; ++k)
+        {
+            float z = splits[c + k];
+            float h = perspective ? z * std::tan(glm::radians(cam.zoom()) * 0.5f) : half_size * height;
+            float w = perspective ? h * aspect : half_size * width;
+            corners[4 * k + 0] = glm::vec3(inv_view * glm::vec4(-w, -h, -z, 1.0f));
+            corners[4 * k + 1] = glm::vec3(inv_view * glm::vec4( w, -h, -z, 1.0f));
+            corners[4 * k + 2] = glm::vec3(inv_view * glm::vec4( w,  h, -z, 1.0f));
+            corners[4 * k + 3] = glm::vec3(inv_view * glm::vec4(-w,  h, -z, 1.0f));
+        }
+
+        glm::vec3 center(0.0f);
+        for(const auto& p : corners)
+            center += p;
+        center /= 8.0f;
+
+        float radius = 0.0f;
+        for(const auto& p : corners)
+            radius = std::max(radius, glm::length(p - center));
+        radius = std::ceil(radius * 16.0f) / 16.0f;
+
+        // casters between the light and the slice are included
+        float caster_distance = AGL_SHADOW_CASTER_DISTANCE;
+        glm::mat4 light_view = glm::lookAt(center + (radius + caster_distance) * light_dir, center, up);
+        glm::mat4 light_proj = glm::ortho(-radius, radius, -radius, radius, 0.0f, 2.0f * radius + caster_distance);
+
+        // texel snapping
+        glm::mat4 shadow_matrix = light_proj * light_view;
+        float texels = 0.5f * info.cascade_size;
+        glm::vec4 origin = shadow_matrix * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f) * texels;
+        glm::vec4 rounded = glm::round(origin);
+        glm::vec4 offset = (rounded - origin) / texels;
+        light_proj[3][0] += offset.x;
+        light_proj[3][1] += offset.y;
+
+        info.cascade_space[c] = light_proj * light_view;
+        info.cascade_splits[c] = splits[c + 1];
+    }
+}
+
+void Render::defer_transparent(spRenderOptions option)
+{
+    app_render_info->transparent_queue.push_back(option);
+}
+
+void Render::draw_transparent()
+{
+    auto& queue = app_render_info->transparent_queue;
+    if(queue.empty())
+        return;
+
+    // view depth of the bounds center
+    const glm::mat4& view = app_render_info->cam_view;
+    std::vector<std::pair<float, RenderOptions*>> order;
+    order.reserve(queue.size());
+    for(auto& ro : queue)
+    {
+        glm::vec3 center = ro->m_position;
+        if(ro->m_bounds.valid())
+        {
+            if(ro->m_world_bounds)
+                center = ro->m_bounds.center;
+            else
+                center = ro->m_position + ro->m_orientation * (ro->m_scale * ro->m_bounds.center);
+        }
+        float depth = -(view * glm::vec4(center, 1.0f)).z;
+        order.push_back({depth, ro.get()});
+    }
+
+    // back to front
+    std::stable_sort(order.begin(), order.end(), 
+        [](const std::pair<float, RenderOptions*>& a, const std::pair<float, RenderOptions*>& b) { 
+            return a.first > b.first; 
+        });
+
+    // single pass. transparent objects do not occlude each other.
+    glDepthMask(GL_FALSE);
+    for(auto& item : order)
+    {
+        RenderOptions* ro = item.second;
+        ro->m_fpDraw(ro->shared_from_this(), ro->m_shader);
+    }
+    glDepthMask(GL_TRUE);
+
+    queue.clear();
+}
+
 void Render::update_render_view(App* app, int width, int height)
 {
     const auto& cam = app->camera();
@@ -341,11 +994,21 @@ void Render::update_render_view(App* app, int width, int height)
     app_render_info->light_direction = light.direction;
     app_render_info->light_color = light.intensity * light.color;
     app_render_info->light_space = light.light_space_matrix();
+    app_render_info->shadow_space = app_render_info->light_space;
+    if(app_render_info->cascade_num > 0)
+    {
+        fit_cascades(*app_render_info, cam, light, width, height);
+    }
+
+    // frustums & stats for this frame
+    app_render_info->cam_frustum = core::Frustum(app_render_info->cam_projection * app_render_info->cam_view);
+    app_render_info->light_frustum = core::Frustum(app_render_info->light_space);
+    app_render_info->cull_stats[0] = CullStats();
+    app_render_info->cull_stats[1] = CullStats();
 
     static std::vector<core::Shader*> shader_list = 
     {
         Render::primitive_shader, Render::lbs_shader, 
-        Render::alpha_primitive_shader, Render::alpha_lbs_shader,
         Render::text_shader
     };
     
@@ -360,6 +1023,7 @@ void Render::draw_pbr(spRenderOptions option, core::Shader* shader)
 {
     if(shader == nullptr)
         return;
+    AGL_PROFILE_SCOPE("draw_pbr");
     
     if(shader == nullptr)
         return;
@@ -374,6 +1038,14 @@ void Render::draw_pbr(spRenderOptions option, core::Shader* shader)
         shader->setVec3("u_lightColor",     Render::app_render_info->light_color);
         shader->setMat4("u_lightSpace",     Render::app_render_info->light_space);
         shader->setVec3("u_skyColor",       Render::app_render_info->sky_color);
+        shader->setInt("u_cascadeNum",      Render::app_render_info->cascade_num);
+        shader->setVec4("u_cascadeSplits",  Render::app_render_info->cascade_splits);
+        if(Render::app_render_info->cascade_num > 0)
+        {
+            shader->setMultipleMat4("u_cascadeSpace", 
+                                    Render::app_render_info->cascade_num, 
+                                    Render::app_render_info->cascade_space);
+        }
         shader->view_update(true);
     }
 
@@ -396,6 +1068,7 @@ void Render::draw_pbr(spRenderOptions option, core::Shader* shader)
     {
         shader->setInt("u_irradianceMap", 0); // environment color
         shader->setInt("u_shadowMap",     1); // shadow
+        shader->setInt("u_shadowCascades", 2 + AGL_MAX_MATERIAL_TEXTURES); // after the material textures
 
         // textures
         for(int i = 0; i < AGL_MAX_MATERIAL_TEXTURES; ++i)
@@ -412,12 +1085,17 @@ void Render::draw_pbr(spRenderOptions option, core::Shader* shader)
             absolute_path(AGL_BACKGROUND_HDR_PATH), Render::tocube_shader);
         glActiveTexture(GL_TEXTURE0);
         glBindTexture(GL_TEXTURE_CUBE_MAP, env_map.handle);
+        Profiler::count_texture();
     }
 
     // set shadow map
     {
         glActiveTexture(GL_TEXTURE1);
         glBindTexture(GL_TEXTURE_2D, Render::depth_map_handle);
+        glActiveTexture(GL_TEXTURE2 + AGL_MAX_MATERIAL_TEXTURES);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, Render::cascade_map_handle);
+        Profiler::count_texture();
+        Profiler::count_texture();
     }
 
     // remove all textures
@@ -425,6 +1103,7 @@ void Render::draw_pbr(spRenderOptions option, core::Shader* shader)
     {
         glActiveTexture(GL_TEXTURE2 + i);
         glBindTexture(GL_TEXTURE_2D, 0);
+        Profiler::count_texture();
     }
 
     // material settings
@@ -449,6 +1128,7 @@ void Render::draw_pbr(spRenderOptions option, core::Shader* shader)
             idx = cnt;
             glActiveTexture(GL_TEXTURE2 + cnt);
             glBindTexture(GL_TEXTURE_2D, handle);
+            Profiler::count_texture();
             cnt++;
         };
 
@@ -490,13 +1170,20 @@ void Render::draw_pbr(spRenderOptions option, core::Shader* shader)
         shader->setFloat("u_grid_interval", option->m_grid_interval);
 
         shader->setBool("u_debug", option->m_debug);
+        shader->setBool("u_use_instance", option->m_instance_num > 0);
     }
 
+    set_vertex_layout(option->m_vao, shader);
+
     // Final rendering
     {
         glBindVertexArray(option->m_vao.vao);
-        glDrawElements(GL_TRIANGLES, option->m_vao.idx_num, GL_UNSIGNED_INT, 0);
+        if(option->m_instance_num > 0)
+            glDrawElementsInstanced(GL_TRIANGLES, option->m_vao.idx_num, GL_UNSIGNED_INT, 0, option->m_instance_num);
+        else
+            glDrawElements(GL_TRIANGLES, option->m_vao.idx_num, GL_UNSIGNED_INT, 0);
         glBindVertexArray(0);
+        Profiler::count_draw(option->m_vao.idx_num / 3, std::max(option->m_instance_num, 1));
     }
 }
 
@@ -504,11 +1191,12 @@ void Render::draw_shadow(spRenderOptions option, core::Shader* shader)
 {
     if(shader == nullptr)
         return;
+    AGL_PROFILE_SCOPE("draw_shadow");
     
     shader->use();
     
-    // set light space
-    shader->setMat4("u_lightSpace", Render::app_render_info->light_space);
+    // set light space of the current pass
+    shader->setMat4("u_lightSpace", Render::app_render_info->shadow_space);
     
     // set model matrix
     if(option->m_use_skinning)
@@ -521,26 +1209,35 @@ void Render::draw_shadow(spRenderOptions option, core::Shader* shader)
     else
     {
         shader->setBool("u_use_lbs", false);
+        shader->setBool("u_use_instance", option->m_instance_num > 0);
         glm::mat4 transform = glm::translate(glm::mat4(1.0), option->m_position) * 
                               glm::mat4(option->m_orientation) * 
                               glm::scale(glm::mat4(1.0), option->m_scale);
         shader->setMat4("u_model", transform);
     }
+    set_vertex_layout(option->m_vao, shader);
 
     // Final rendering
     glBindVertexArray(option->m_vao.vao);
-    glDrawElements(GL_TRIANGLES, option->m_vao.idx_num, GL_UNSIGNED_INT, 0);
+    if(option->m_instance_num > 0)
+        glDrawElementsInstanced(GL_TRIANGLES, option->m_vao.idx_num, GL_UNSIGNED_INT, 0, option->m_instance_num);
+    else
+        glDrawElements(GL_TRIANGLES, option->m_vao.idx_num, GL_UNSIGNED_INT, 0);
     glBindVertexArray(0);
+    Profiler::count_draw(option->m_vao.idx_num / 3, std::max(option->m_instance_num, 1));
 }
 
 void Render::draw_text(spRenderOptions option, core::Shader* shader)
 {
     if(shader == nullptr)
         return;
+    AGL_PROFILE_SCOPE("draw_text");
 
-    float line_space = option->m_line_space;
+    // layout is in font pixels
+    const auto& layout = Render::font_texture->layout(option->m_text, option->m_line_space);
+    if(layout.vertex_num == 0)
+        return;
 
-    std::string text = option->m_text;
     float scale = 0.25f * option->m_scale.x / AGL_FONT_RESOLUTION;
 
     shader->use();
@@ -553,76 +1250,19 @@ void Render::draw_text(spRenderOptions option, core::Shader* shader)
 
     glm::mat4 transform = glm::translate(glm::mat4(1.0), option->m_position) * 
                             glm::mat4(option->m_orientation) * 
-                            glm::scale(glm::mat4(1.0), option->m_scale);
+                            glm::scale(glm::mat4(1.0), option->m_scale) *
+                            glm::scale(glm::mat4(1.0), glm::vec3(scale, scale, 1.0f));
     shader->setMat4("u_model", transform);
     shader->setVec3("u_textColor", option->m_materials.at(0).albedo);
 
+    // render the whole string at once
     glActiveTexture(GL_TEXTURE0);
-    glBindVertexArray(Render::font_texture->vao());
-
-    struct FontPos 
-    {
-        unsigned int textureID;
-        float xpos, ypos;
-        float w, h;
-        float advance;
-        int line;
-    };
-
-    // render
-    std::vector<FontPos> str_chars;
-    str_chars.reserve(text.length());
-
-    float xoffset = 0;
-    float yoffset = 0;
- 
-    std::string::const_iterator c;
-    float x = 0;
-    float y = 0;
-    for (c = text.begin(); c != text.end(); c++) 
-    {
-        if(*c == '\n')
-        {
-            y -= AGL_FONT_RESOLUTION * scale * line_space;
-            x = 0;
-            continue;
-        }
-
-        const auto& ch = font_texture->character(*c);
-        FontPos fp;
-        fp.textureID = ch.TextureID;
-        fp.xpos = x + ch.Bearing.x * scale;
-        fp.ypos = y - (ch.Size.y - ch.Bearing.y) * scale;
-        fp.w = ch.Size.x * scale;
-        fp.h = ch.Size.y * scale;
-        x += (ch.Advance >> 6) * scale;
-        str_chars.push_back(std::move(fp));
-    }
-
-    for(auto& f : str_chars)
-    {
-        float vertices[4 * 6] = 
-        {
-            xoffset + f.xpos,       yoffset + f.ypos + f.h,   0.0f, 0.0f,
-            xoffset + f.xpos,       yoffset + f.ypos,         0.0f, 1.0f,
-            xoffset + f.xpos + f.w, yoffset + f.ypos,         1.0f, 1.0f,
-            xoffset + f.xpos,       yoffset + f.ypos + f.h,   0.0f, 0.0f,
-            xoffset + f.xpos + f.w, yoffset + f.ypos,         1.0f, 1.0f,
-            xoffset + f.xpos + f.w, yoffset + f.ypos + f.h,   1.0f, 0.0f
-        };
-
-        // render glyph texture over quad
-        glBindTexture(GL_TEXTURE_2D, f.textureID);
-        // update content of VBO memory
-        glBindBuffer(GL_ARRAY_BUFFER, font_texture->vbo());
-        glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(vertices), vertices); // be sure to use glBufferSubData and not glBufferData
-
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
-        // render quad
-        glDrawArrays(GL_TRIANGLES, 0, 6);
-    }
+    glBindTexture(GL_TEXTURE_2D, Render::font_texture->texture());
+    glBindVertexArray(layout.vao);
+    glDrawArrays(GL_TRIANGLES, 0, layout.vertex_num);
+    glBindVertexArray(0);
+    Profiler::count_texture();
+    Profiler::count_draw(layout.vertex_num / 3);
 }
-    
-
 
 }
\ No newline at end of file
@@ -7,22 +7,26 @@ namespace a::gl {
 
 RenderOptions::RenderOptions(core::VAO vao, 
                              core::Shader* shader, 
-                             core::Shader* alpha_shader, 
                              void (*fpDraw)(spRenderOptions, core::Shader*)):
     m_vao(vao),
     m_shader(shader),
-    m_alpha_shader(alpha_shader),
     m_position(glm::vec3(0.0f, 0.0f, 0.0f)),
     m_orientation(glm::mat3(1.0f)),
     m_scale(glm::vec3(1.0f, 1.0f, 1.0f)),
     m_materials({Material()}),
     m_disp_map_scale(0.01f),
     m_uv_repeat(1.0f),
+    m_transparent(false),
     m_draw_floor_grid(false),
     m_grid_color(1.0f, 1.0f, 1.0f),
     m_grid_width(1.0f),
     m_grid_interval(1.0f),
     m_debug(false),
+    m_bounds(vao.bounds),
+    m_world_bounds(false),
+    m_frustum_cull(true),
+    m_static_caster(true),
+    m_instance_num(0),
     m_use_skinning(false),
     m_buffer_transforms(),
     m_text(),
@@ -33,12 +37,16 @@ RenderOptions::RenderOptions(core::VAO vao,
 
 void RenderOptions::draw()
 {
-    this->m_fpDraw(shared_from_this(), this->m_shader);
-}
+    if(Render::is_culled(this, true))
+        return;
 
-void RenderOptions::alpha_draw()
-{
-    this->m_fpDraw(shared_from_this(), this->m_alpha_shader);
+    // transparent objects are drawn after all the opaque objects
+    if(is_transparent() && Render::render_type == Render::RenderMode::PBR)
+    {
+        Render::defer_transparent(shared_from_this());
+        return;
+    }
+    this->m_fpDraw(shared_from_this(), this->m_shader);
 }
 
 spRenderOptions RenderOptions::position(Vec3 pos)
@@ -128,7 +136,7 @@ spRenderOptions RenderOptions::color(Vec3 clr, int mid)
     if(mid < m_materials.size())
     {
         this->m_materials.at(mid).albedo = a::gl::to_glm(clr);
-        this->m_materials.at(mid).albedo_map.handle = 0;
+        this->m_materials.at(mid).albedo_map = Texture();
     }
     return shared_from_this();
 }
@@ -157,6 +165,7 @@ spRenderOptions RenderOptions::alpha(float a, int mid)
     if(mid < m_materials.size())
     {   
         this->m_materials.at(mid).alpha = a;
+        this->update_transparent();
     }
     return shared_from_this();
 }
@@ -166,7 +175,7 @@ spRenderOptions RenderOptions::metallic(float v, int mid)
     if(mid < m_materials.size())
     {
         this->m_materials.at(mid).metallic = v;
-        this->m_materials.at(mid).metallic_map.handle = 0;
+        this->m_materials.at(mid).metallic_map = Texture();
     }
     return shared_from_this();
 }
@@ -176,7 +185,7 @@ spRenderOptions RenderOptions::roughness(float v, int mid)
     if(mid < m_materials.size())
     {
         this->m_materials.at(mid).roughness = v;
-        this->m_materials.at(mid).roughness_map.handle = 0;
+        this->m_materials.at(mid).roughness_map = Texture();
     }
     return shared_from_this();
 }
@@ -225,18 +234,29 @@ spRenderOptions RenderOptions::debug(bool is_debug)
     return shared_from_this();
 }
 
-bool RenderOptions::is_transparent()
+spRenderOptions RenderOptions::frustum_cull(bool use_cull)
+{
+    this->m_frustum_cull = use_cull;
+    return shared_from_this();
+}
+
+spRenderOptions RenderOptions::static_caster(bool is_static)
 {
-    bool transparent = false;
+    this->m_static_caster = is_static;
+    return shared_from_this();
+}
+
+void RenderOptions::update_transparent()
+{
+    m_transparent = false;
     for(auto& material : m_materials)
     {
         if(material.alpha != 1.0f)
         {
-            transparent = true;
+            m_transparent = true;
             break;
         }
     }
-    return transparent;
 }
 
 // ****** RenderOptionsVec ****** //
@@ -248,27 +268,8 @@ RenderOptionsVec::RenderOptionsVec(std::vector<spRenderOptions>& list)
 
 void RenderOptionsVec::draw()
 {
-#if 1
-    for(auto& ro : m_render_list)
-    {
-        if(Render::render_type == Render::RenderMode::SHADOW)
-        {
-            ro->draw();
-        }
-        else
-        {
-            bool transparent = ro->is_transparent();
-            if(transparent)
-            {
-                ro->alpha_draw();
-            }
-            ro->draw();
-        }
-    }
-#else
     for(auto& ro : m_render_list)
         ro->draw();
-#endif
 }
 
 spRenderOptionsVec RenderOptionsVec::orientation(Mat3 m3)
@@ -361,5 +362,23 @@ spRenderOptionsVec RenderOptionsVec::alpha(float a)
     return shared_from_this();
 }
 
+spRenderOptionsVec RenderOptionsVec::frustum_cull(bool use_cull)
+{
+    for(auto& ro : m_render_list)
+    {
+        ro->frustum_cull(use_cull);
+    }
+    return shared_from_this();
+}
+
+spRenderOptionsVec RenderOptionsVec::static_caster(bool is_static)
+{
+    for(auto& ro : m_render_list)
+    {
+        ro->static_caster(is_static);
+    }
+    return shared_from_this();
+}
+
 
 }
\ No newline at end of file
@@ -1,95 +1,299 @@
 #include "aOpenGL/text.h"
 #include "aOpenGL/config.h"
 #include <iostream>
+#include <cstring>
 
 namespace a::gl {
 
-FontTexture::FontTexture(const std::string& font_path)
+// space between glyphs in the atlas. prevents bleeding with linear filtering.
+static const int glyph_padding = 2;
+
+/**
+ * @return unicode code points of utf-8 string. invalid bytes are skipped.
+ */
+static std::vector<unsigned int> decode_utf8(const std::string& text)
 {
-#if 1
-    FT_Library ft;
-    FT_Face face;
+    std::vector<unsigned int> codes;
+    codes.reserve(text.length());
+
+    int i = 0, n = (int)text.length();
+    while(i < n)
+    {
+        unsigned char c = text[i];
+        int len = 1;
+        unsigned int code = c;
+        if(c >= 0xF0)      { len = 4; code = c & 0x07; }
+        else if(c >= 0xE0) { len = 3; code = c & 0x0F; }
+        else if(c >= 0xC0) { len = 2; code = c & 0x1F; }
+        else if(c >= 0x80) { i++; continue; }
 
+        if(i + len > n)
+            break;
+        for(int k = 1; k < len; ++k)
+            code = (code << 6) | (text[i + k] & 0x3F);
+
+        codes.push_back(code);
+        i += len;
+    }
+    return codes;
+}
+
+FontTexture::FontTexture(const std::string& font_path):
+    m_width(AGL_FONT_ATLAS_WIDTH),
+    m_height(AGL_FONT_ATLAS_WIDTH / 2)
+{
     // FREETYPE_H
-    if (FT_Init_FreeType(&ft))
+    if (FT_Init_FreeType(&m_ft))
     {
         std::cout << "ERROR::FREETYPE: Could not init FreeType Library" << std::endl;
+        m_ft = nullptr;
         return;
     }
-    
-    if (FT_New_Face(ft, font_path.c_str(), 0, &face))
+
+    if (FT_New_Face(m_ft, font_path.c_str(), 0, &m_face))
+    {
+        std::cout << "ERROR::FREETYPE: Failed to load font" << std::endl;
+        m_face = nullptr;
+        return;
+    }
+
+    // set size to load glyphs as
+    FT_Set_Pixel_Sizes(m_face, 0, AGL_FONT_RESOLUTION);
+
+    // create empty atlas
+    m_pixels.resize((size_t)m_width * m_height, 0);
+    glGenTextures(1, &m_atlas);
+    glBindTexture(GL_TEXTURE_2D, m_atlas);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, m_width, m_height, 0, GL_RED, GL_UNSIGNED_BYTE, &m_pixels[0]);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+FontTexture::~FontTexture()
+{
+    for(auto& item : m_layouts)
+    {
+        glDeleteVertexArrays(1, &item.second.layout.vao);
+        glDeleteBuffers(1, &item.second.layout.vbo);
+    }
+    if(m_atlas)
+        glDeleteTextures(1, &m_atlas);
+
+    // destroy FreeType
+    if(m_face)
+        FT_Done_Face(m_face);
+    if(m_ft)
+        FT_Done_FreeType(m_ft);
+}
+
+const FontTexture::CharInfo& FontTexture::character(unsigned int code)
+{
+    auto iter = m_chars.find(code);
+    if(iter == m_chars.end())
+    {
+        add_glyph(code);
+        iter = m_chars.find(code);
+    }
+    return iter->second;
+}
+
+void FontTexture::add_glyph(unsigned int code)
+{
+    CharInfo character = {glm::vec2(0, 0), glm::vec2(0, 0), glm::ivec2(0, 0), glm::ivec2(0, 0), 0};
+
+    // Load character glyph
+    if (m_face == nullptr || FT_Load_Char(m_face, code, FT_LOAD_RENDER))
     {
-        std::cout << "ERROR::FREETYPE: Failed to load font" << std::endl;  
+        std::cout << "ERROR::FREETYTPE: Failed to load Glyph " << code << std::endl;
+        m_chars.insert(std::pair<unsigned int, CharInfo>(code, character));
         return;
     }
 
-    // create 
-        // set size to load glyphs as
-        FT_Set_Pixel_Sizes(face, 0, AGL_FONT_RESOLUTION);
+    const FT_Bitmap& bitmap = m_face->glyph->bitmap;
+    int w = bitmap.width;
+    int h = bitmap.rows;
+    character.Size    = glm::ivec2(w, h);
+    character.Bearing = glm::ivec2(m_face->glyph->bitmap_left, m_face->glyph->bitmap_top);
+    character.Advance = static_cast<unsigned int>(m_face->glyph->advance.x);
 
-        // disable byte-alignment restriction
-        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    if(w > 0 && h > 0)
+    {
+        // find a place in the atlas (shelf packing)
+        if(m_shelf_x + w + glyph_padding > m_width)
+        {
+            m_shelf_x = 0;
+            m_shelf_y += m_shelf_h;
+            m_shelf_h = 0;
+        }
+        while(m_shelf_y + h + glyph_padding > m_height)
+        {
+            int height = m_height;
+            grow_atlas();
+            if(height == m_height)
+                break;
+        }
 
-        // load first 128 characters of ASCII set
-        for (unsigned char c = 0; c < 128; c++)
+        if(m_shelf_y + h + glyph_padding > m_height)
         {
-            // Load character glyph 
-            if (FT_Load_Char(face, c, FT_LOAD_RENDER))
+            std::cout << "ERROR::FREETYTPE: glyph atlas is full" << std::endl;
+        }
+        else
+        {
+            int x = m_shelf_x;
+            int y = m_shelf_y;
+            for(int row = 0; row < h; ++row)
             {
-                std::cout << "ERROR::FREETYTPE: Failed to load Glyph" << std::endl;
-                continue;
+                std::memcpy(&m_pixels[(size_t)(y + row) * m_width + x],
+                            bitmap.buffer + row * bitmap.pitch, w);
             }
-            // generate texture
-            unsigned int texture;
-            glGenTextures(1, &texture);
-            glBindTexture(GL_TEXTURE_2D, texture);
-            glTexImage2D(
-                GL_TEXTURE_2D,
-                0,
-                GL_RED,
-                face->glyph->bitmap.width,
-                face->glyph->bitmap.rows,
-                0,
-                GL_RED,
-                GL_UNSIGNED_BYTE,
-                face->glyph->bitmap.buffer
-            );
-            // set texture options
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-            // now store character for later use
-            CharInfo character = {
-                texture,
-                glm::ivec2(face->glyph->bitmap.width, face->glyph->bitmap.rows),
-                glm::ivec2(face->glyph->bitmap_left, face->glyph->bitmap_top),
-                static_cast<unsigned int>(face->glyph->advance.x)
-            };
-            m_chars.insert(std::pair<char, CharInfo>(c, character));
+
+            glBindTexture(GL_TEXTURE_2D, m_atlas);
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+            glPixelStorei(GL_UNPACK_ROW_LENGTH, m_width);
+            glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, w, h, GL_RED, GL_UNSIGNED_BYTE, &m_pixels[(size_t)y * m_width + x]);
+            glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+            glBindTexture(GL_TEXTURE_2D, 0);
+
+            // rows of the bitmap go from top to bottom
+            character.UV0 = glm::vec2((float)x / m_width, (float)y / m_height);
+            character.UV1 = glm::vec2((float)(x + w) / m_width, (float)(y + h) / m_height);
+
+            m_shelf_x += w + glyph_padding;
+            m_shelf_h = std::max(m_shelf_h, h + glyph_padding);
         }
-        glBindTexture(GL_TEXTURE_2D, 0);
-
-        // destroy FreeType once we're finished
-        FT_Done_Face(face);
-        FT_Done_FreeType(ft);
-
-        // configure VAO/VBO for texture quads
-        // -----------------------------------
-        unsigned int VAO, VBO;
-        glGenVertexArrays(1, &VAO);
-        glGenBuffers(1, &VBO);
-        glBindVertexArray(VAO);
-        glBindBuffer(GL_ARRAY_BUFFER, VBO);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(float) * 6 * 4, NULL, GL_DYNAMIC_DRAW);
+    }
+
+    m_chars.insert(std::pair<unsigned int, CharInfo>(code, character));
+}
+
+void FontTexture::grow_atlas()
+{
+    GLint max_size = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_size);
+    if(2 * m_height > max_size)
+        return;
+
+    // the existing glyphs keep their texel position, only the v coordinate changes.
+    int old_height = m_height;
+    m_height *= 2;
+    m_pixels.resize((size_t)m_width * m_height, 0);
+    for(auto& item : m_chars)
+    {
+        item.second.UV0.y = item.second.UV0.y * old_height / m_height;
+        item.second.UV1.y = item.second.UV1.y * old_height / m_height;
+    }
+
+    glBindTexture(GL_TEXTURE_2D, m_atlas);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, m_width, m_height, 0, GL_RED, GL_UNSIGNED_BYTE, &m_pixels[0]);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    // cached layouts have stale uvs
+    m_generation++;
+}
+
+const FontTexture::Layout& FontTexture::layout(const std::string& text, float line_space)
+{
+    auto key = std::make_pair(text, line_space);
+    auto iter = m_layouts.find(key);
+    if(iter != m_layouts.end())
+    {
+        m_lru.splice(m_lru.begin(), m_lru, iter->second.lru);
+    }
+    else
+    {
+        // remove the least recently used string
+        if((int)m_layouts.size() >= AGL_TEXT_CACHE_SIZE)
+        {
+            auto oldest = m_layouts.find(m_lru.back());
+            glDeleteVertexArrays(1, &oldest->second.layout.vao);
+            glDeleteBuffers(1, &oldest->second.layout.vbo);
+            m_layouts.erase(oldest);
+            m_lru.pop_back();
+        }
+        m_lru.push_front(key);
+        iter = m_layouts.insert(std::make_pair(key, LayoutEntry())).first;
+        iter->second.lru = m_lru.begin();
+    }
+
+    Layout& layout = iter->second.layout;
+    if(layout.generation != m_generation)
+    {
+        build_layout(layout, text, line_space);
+    }
+    return layout;
+}
+
+void FontTexture::build_layout(Layout& layout, const std::string& text, float line_space)
+{
+    std::vector<unsigned int> codes = decode_utf8(text);
+
+    // rasterize new glyphs first. this can grow the atlas.
+    for(unsigned int code : codes)
+    {
+        if(code != '\n')
+            character(code);
+    }
+
+    // two triangles per glyph: (x, y, u, v)
+    std::vector<float> vertices;
+    vertices.reserve(codes.size() * 6 * 4);
+
+    float x = 0;
+    float y = 0;
+    for(unsigned int code : codes)
+    {
+        if(code == '\n')
+        {
+            y -= AGL_FONT_RESOLUTION * line_space;
+            x = 0;
+            continue;
+        }
+
+        const auto& ch = m_chars.at(code);
+        float xpos = x + ch.Bearing.x;
+        float ypos = y - (ch.Size.y - ch.Bearing.y);
+        float w = ch.Size.x;
+        float h = ch.Size.y;
+        x += (ch.Advance >> 6);
+
+        if(ch.Size.x == 0 || ch.Size.y == 0)
+            continue;
+
+        float quad[4 * 6] =
+        {
+            xpos,     ypos + h,   ch.UV0.x, ch.UV0.y,
+            xpos,     ypos,       ch.UV0.x, ch.UV1.y,
+            xpos + w, ypos,       ch.UV1.x, ch.UV1.y,
+            xpos,     ypos + h,   ch.UV0.x, ch.UV0.y,
+            xpos + w, ypos,       ch.UV1.x, ch.UV1.y,
+            xpos + w, ypos + h,   ch.UV1.x, ch.UV0.y
+        };
+        vertices.insert(vertices.end(), quad, quad + 4 * 6);
+    }
+
+    // configure VAO/VBO for texture quads
+    if(layout.vao == 0)
+    {
+        glGenVertexArrays(1, &layout.vao);
+        glGenBuffers(1, &layout.vbo);
+        glBindVertexArray(layout.vao);
+        glBindBuffer(GL_ARRAY_BUFFER, layout.vbo);
         glEnableVertexAttribArray(0);
         glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), 0);
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
         glBindVertexArray(0);
+    }
 
-        m_vao = VAO;
-        m_vbo = VBO;
-#endif
+    glBindBuffer(GL_ARRAY_BUFFER, layout.vbo);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(float) * vertices.size(), vertices.empty() ? NULL : &vertices[0], GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    layout.vertex_num = (int)vertices.size() / 4;
+    layout.generation = m_generation;
 }
 
-}
\ No newline at end of file
+}
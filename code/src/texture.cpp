@@ -1,5 +1,6 @@
 #include "aOpenGL/texture.h"
 #include "aOpenGL/core/primitive.h"
+#include "aOpenGL/config.h"
 
 #include <glm/gtc/matrix_transform.hpp>
 #include <iostream>
@@ -56,15 +57,22 @@ static GLuint generate_texture(unsigned char* img, int width, int height, int ch
     return texture;
 }
 
+TextureLoader::TextureLoader()
+{
+    m_stats.bytes_budget = AGL_TEXTURE_CACHE_BUDGET;
+}
+
+/**
+ * @brief estimated gpu memory. drivers usually store RGB8 as RGBA8, and the mipmap chain adds 1/3.
+ */
+static size_t texture_bytes(const Texture& texture)
+{
+    return (size_t)texture.width * (size_t)texture.height * 4 * 4 / 3;
+}
+
 Texture TextureLoader::_create(std::string path, unsigned char* img, int width, int height, int channel, bool nearest)
 {
-    auto iter = m_textures.find(path);
-    if(iter != m_textures.end())
-    {
-        //newTexture = iter->second;
-        glDeleteTextures(1, &(iter->second.handle));
-        m_textures.erase(path);
-    }
+    this->_erase(path);
 
     // read image data
     //auto data = a::gl::Image::create(path, img, width, height, channel);
@@ -75,28 +83,107 @@ Texture TextureLoader::_create(std::string path, unsigned char* img, int width,
     newTexture.width   = width;
     newTexture.height  = height;
     newTexture.channel = channel;
-    m_textures[path]   = newTexture;
-    
-    return m_textures.at(path);
+    return this->_insert(newTexture);
 }
 
 Texture TextureLoader::_load(std::string path, int channel)
+{
+    auto iter = m_textures.find(path);
+    if(iter != m_textures.end())
+    {
+        m_stats.hits++;
+        m_lru.splice(m_lru.begin(), m_lru, iter->second.lru);
+        return iter->second.texture;
+    }
+    m_stats.misses++;
+
+    // read image data
+    auto data = a::gl::Image::load(path, channel);
+    
+    Texture newTexture;
+    newTexture.path = path;
+    newTexture.handle = generate_texture(data->image, data->width, data->height, data->channel);
+    newTexture.width = data->width;
+    newTexture.height = data->height;
+    newTexture.channel = data->channel;
+
+    if(m_free_pixels)
+    {
+        data.reset();
+        a::gl::Image::release(path);
+    }
+    return this->_insert(newTexture);
+}
+
+Texture TextureLoader::_insert(Texture texture)
+{
+    const std::string path = texture.path;
+    texture.ref = std::make_shared<int>(0);
+    m_lru.push_front(path);
+
+    Entry entry;
+    entry.texture   = texture;
+    entry.bytes     = texture_bytes(texture);
+    entry.pin_count = 0;
+    entry.lru       = m_lru.begin();
+    m_textures[path] = entry;
+
+    m_stats.bytes_resident += entry.bytes;
+    m_stats.entries = m_textures.size();
+
+    // the returned copy keeps the new texture pinned while evicting
+    this->_evict();
+    return texture;
+}
+
+void TextureLoader::_erase(std::string path)
 {
     auto iter = m_textures.find(path);
     if(iter == m_textures.end())
+        return;
+    
+    glDeleteTextures(1, &(iter->second.texture.handle));
+    m_stats.bytes_resident -= iter->second.bytes;
+    m_lru.erase(iter->second.lru);
+    m_textures.erase(iter);
+    m_stats.entries = m_textures.size();
+}
+
+void TextureLoader::_evict()
+{
+    if(m_stats.bytes_budget == 0)
+        return;
+
+    // from the least recently used. skip textures still referenced by materials or pinned.
+    auto it = m_lru.end();
+    while(m_stats.bytes_resident > m_stats.bytes_budget && it != m_lru.begin())
     {
-        // read image data
-        auto data = a::gl::Image::load(path, channel);
-        
-        Texture newTexture;
-        newTexture.path = path;
-        newTexture.handle = generate_texture(data->image, data->width, data->height, data->channel);
-        newTexture.width = data->width;
-        newTexture.height = data->height;
-        newTexture.channel = data->channel;
-        m_textures[path] = newTexture;
+        --it;
+        const Entry& entry = m_textures.at(*it);
+        if(entry.pin_count > 0 || entry.texture.ref.use_count() > 1)
+            continue;
+
+        auto victim = it++;
+        m_stats.evictions++;
+        this->_erase(*victim);
     }
-    return m_textures.at(path);
+}
+
+void TextureLoader::_pin(std::string path, int count)
+{
+    auto iter = m_textures.find(path);
+    if(iter == m_textures.end())
+        return;
+    
+    iter->second.pin_count = std::max(iter->second.pin_count + count, 0);
+    if(iter->second.pin_count == 0)
+        this->_evict();
+}
+
+void TextureLoader::_set_budget(size_t bytes)
+{
+    m_stats.bytes_budget = bytes;
+    this->_evict();
 }
 
 static GLuint generate_hdr_texture(float* img, int width, int height, int channel)
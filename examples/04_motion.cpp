@@ -54,9 +54,8 @@ public:
 
     void render_xray() override
     {
-        agl::Render::skeleton(model)
-            ->color(0.9, 0.9, 0)
-            ->draw();
+        // one instanced draw for all the joints
+        agl::Render::batch_skeleton(model, Vec3(0.9, 0.9, 0));
     }
 };
 
@@ -0,0 +1,63 @@
+#include <aOpenGL.h>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <string>
+
+// headless rendering without a window (EGL / OSMesa)
+// software rasterizer: LIBGL_ALWAYS_SOFTWARE=1 ./headless 120 [png|raw|y4m|mjpeg|ffmpeg]
+
+class MyApp : public agl::App
+{
+public:
+    int frame = 0;
+
+    void start() override
+    {
+        set_capture_path("capture/headless/");
+        capture(true);
+    }
+
+    void update() override
+    {
+        frame++;
+    }
+
+    void render() override
+    {
+        agl::Render::plane()
+            ->scale(10.0f)
+            ->floor_grid(true)
+            ->draw();
+
+        for(int i = 0; i < 10; ++i)
+        {
+            agl::Render::cube()
+                ->position(i - 5.0f, 0.5f + 0.5f * std::sin(0.1f * (frame + i)), 0.0f)
+                ->scale(0.5f)
+                ->color(i * 0.1, 0, 0)
+                ->draw();
+        }
+    }
+};
+
+int main(int argc, char* argv[])
+{
+    int frame_num = argc > 1 ? std::atoi(argv[1]) : 60;
+    std::string format = argc > 2 ? argv[2] : "png";
+
+    MyApp app;
+    app.set_window_size(640, 360);
+    if(format == "raw")    app.set_capture_format(agl::CaptureFormat::RAW);
+    if(format == "y4m")    app.set_capture_format(agl::CaptureFormat::Y4M);
+    if(format == "mjpeg")  app.set_capture_format(agl::CaptureFormat::MJPEG);
+    if(format == "ffmpeg") app.set_capture_format(agl::CaptureFormat::PIPE);
+
+    auto begin = std::chrono::steady_clock::now();
+    agl::AppManager::start_headless(&app, frame_num);
+    auto end = std::chrono::steady_clock::now();
+
+    double sec = std::chrono::duration<double>(end - begin).count();
+    std::cout << app.frame << " frames, " << app.frame / sec << " fps" << std::endl;
+    return 0;
+}
@@ -0,0 +1,71 @@
+#include <aOpenGL.h>
+#include <cmath>
+
+// update() runs at 30Hz on its own thread, render() interpolates between the last two states.
+// key 'v' toggles vsync.
+
+class MyApp : public agl::App
+{
+public:
+    // simulation state (update thread)
+    float sim_prev = 0.0f, sim_curr = 0.0f, velocity = 2.0f;
+
+    // render state (copied in sync())
+    float prev = 0.0f, curr = 0.0f;
+
+    void start() override
+    {
+        set_fixed_timestep(1.0f / 30.0f);
+        set_update_thread(true);
+    }
+
+    void update() override
+    {
+        sim_prev = sim_curr;
+        sim_curr += velocity * timestep();
+        if(std::abs(sim_curr) > 5.0f)
+            velocity = -velocity;
+    }
+
+    void sync() override
+    {
+        prev = sim_prev;
+        curr = sim_curr;
+    }
+
+    void render() override
+    {
+        agl::Render::plane()
+            ->scale(10.0f)
+            ->floor_grid(true)
+            ->draw();
+
+        // interpolated
+        float x = prev + (curr - prev) * alpha();
+        agl::Render::cube()
+            ->position(x, 0.5f, 0.0f)
+            ->scale(0.5f)
+            ->color(0.8, 0.1, 0.1)
+            ->draw();
+
+        // raw simulation state
+        agl::Render::cube()
+            ->position(curr, 0.5f, 1.0f)
+            ->scale(0.5f)
+            ->color(0.1, 0.1, 0.8)
+            ->draw();
+    }
+
+    void key_callback(char key, int action) override
+    {
+        if(key == 'v' && action == GLFW_PRESS)
+            set_vsync(!vsync());
+    }
+};
+
+int main(int argc, char* argv[])
+{
+    MyApp app;
+    agl::AppManager::start(&app);
+    return 0;
+}
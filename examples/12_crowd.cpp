@@ -0,0 +1,103 @@
+#include <aOpenGL.h>
+#include <iostream>
+#include <chrono>
+
+// 200 ybots posed and skinned in parallel by the update graph.
+// per-stage timings are printed every 120 frames.
+
+class MyApp : public agl::App
+{
+public:
+    static constexpr int rows = 10;
+    static constexpr int cols = 20;
+
+    std::vector<agl::spModel> models;
+    std::vector<Vec3>    offsets;
+    std::vector<agl::Pose>    poses;   // per model, reused every frame
+    std::vector<agl::Motion>  motions;
+
+    int frame = 0;
+    double render_ms = 0.0;
+
+    void start() override
+    {
+        const char* model_path  = "../data/fbx/ybot/model/ybot.fbx";
+        const char* motion_path = "../data/fbx/ybot/motion/Running To Turn.fbx";
+
+        agl::FBX model_fbx(model_path);
+        auto model = model_fbx.model();
+
+        agl::FBX motion_fbx(motion_path);
+        motions = motion_fbx.motion(model);
+
+        for(int r = 0; r < rows; ++r)
+        {
+            for(int c = 0; c < cols; ++c)
+            {
+                models.push_back(model->copy());
+                offsets.push_back(Vec3(2.0f * (c - cols / 2), 0.0f, 2.0f * (r - rows / 2)));
+            }
+        }
+        poses.resize(models.size());
+
+        int n = (int)models.size();
+        const auto& motion = motions.at(0);
+
+        // pose application + hierarchy update
+        update_graph().add("pose", n, [this, &motion](int i){
+            int f = (frame + 7 * i) % (int)motion.poses.size();
+            poses[i] = motion.poses.at(f);
+            poses[i].root_position += offsets[i];
+            models[i]->set_pose(poses[i]);
+        });
+
+        // skinning palette
+        update_graph().add("skin", n, [this](int i){
+            models[i]->update_mesh();
+        }, {"pose"});
+
+        camera().set_position(Vec3(0.0f, 15.0f, 30.0f));
+    }
+
+    void update() override
+    {
+        frame++;
+    }
+
+    void render() override
+    {
+        auto begin = std::chrono::steady_clock::now();
+
+        agl::Render::plane()
+            ->scale(50.0f)
+            ->color(0.15f, 0.15f, 0.15f)
+            ->floor_grid(true)
+            ->draw();
+
+        // palette is already built by the "skin" stage
+        for(auto& model : models)
+            agl::Render::model(model, false)->draw();
+
+        auto end = std::chrono::steady_clock::now();
+        render_ms += std::chrono::duration<double, std::milli>(end - begin).count();
+    }
+
+    void late_update() override
+    {
+        if(frame % 120 != 0)
+            return;
+
+        std::cout << "[" << models.size() << " models, " << agl::JobSystem::thread_num() + 1 << " threads]";
+        for(const auto& t : update_graph().timings())
+            std::cout << " " << t.name << ": " << t.ms << "ms";
+        std::cout << " render submit (all passes): " << render_ms << "ms" << std::endl;
+        render_ms = 0.0;
+    }
+};
+
+int main(int argc, char* argv[])
+{
+    MyApp app;
+    agl::AppManager::start(&app);
+    return 0;
+}
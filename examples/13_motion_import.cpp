@@ -0,0 +1,46 @@
+#include <aOpenGL.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+
+// Batch motion import without a window.
+// usage: ./motion_import [motion directory] [threads]
+
+int main(int argc, char* argv[])
+{
+    const char* model_path = "../data/fbx/ybot/model/ybot.fbx";
+    std::string motion_dir = argc > 1 ? argv[1] : "../data/fbx/ybot/motion";
+    int threads = argc > 2 ? std::atoi(argv[2]) : 0;
+
+    // joints only: no GL context is needed
+    auto joints = agl::FBX(model_path).joints();
+
+    std::vector<std::string> paths;
+    for(const auto& entry : std::filesystem::directory_iterator(motion_dir))
+    {
+        if(entry.path().extension() == ".fbx")
+            paths.push_back(entry.path().string());
+    }
+    std::sort(paths.begin(), paths.end());
+
+    auto begin = std::chrono::steady_clock::now();
+    auto files = agl::FBX::import_motions(paths, joints, 0.01f, 
+        [](const agl::MotionImport& file, int done, int total)
+        {
+            std::cout << "[" << done << "/" << total << "] " << file.path << ": "
+                      << (file.ok() ? std::to_string(file.motions.size()) + " motions" : file.error)
+                      << " (" << file.ms << " ms)" << std::endl;
+        }, threads);
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+
+    int motion_num = 0, failed = 0;
+    for(const auto& file : files)
+    {
+        motion_num += (int)file.motions.size();
+        failed += file.ok() ? 0 : 1;
+    }
+    std::cout << paths.size() << " files, " << motion_num << " motions, " << failed << " failed in " << ms << " ms" << std::endl;
+    return failed == 0 ? 0 : 1;
+}
@@ -11,6 +11,7 @@ in vec3 fs_tangent;
 in vec3 fs_bitangent;
 in vec4 fs_lightSpacePos;
 flat in int fs_materialID;
+in vec4 fs_instanceColor;
 
 // ----------------------------------------------------------------------------
 uniform mat4 u_projection;
@@ -20,6 +21,7 @@ uniform vec3 u_lightDirection;
 uniform mat4 u_lightSpace;
 uniform vec3 u_lightColor;
 uniform bool u_debug;
+uniform bool u_use_instance;
 
 uniform vec3 u_skyColor;
 
@@ -35,6 +37,14 @@ uniform bvec3 u_mat_isGS_txt[MAX_MATERIAL_NUM];   // is glossiness & specular te
 uniform samplerCube u_irradianceMap;              // IBL
 uniform sampler2D   u_shadowMap;                  // shadow
 
+// ----------------------------------------------------------------------------
+// cascaded shadow maps
+#define MAX_SHADOW_CASCADES 4
+uniform sampler2DArray u_shadowCascades;
+uniform int  u_cascadeNum;                         // 0: use u_shadowMap
+uniform vec4 u_cascadeSplits;                      // far distance of each cascade
+uniform mat4 u_cascadeSpace[MAX_SHADOW_CASCADES];
+
 // ----------------------------------------------------------------------------
 // textures
 #define MAX_MATERIAL_TEXTURE 25
@@ -125,6 +135,46 @@ float ShadowCalculation(vec4 fragPosLightSpace, vec3 normal, vec3 lightDir, samp
     return shadow;
 }
 // ----------------------------------------------------------------------------
+float CascadeShadowCalculation(vec3 worldPos, vec3 normal, vec3 lightDir)
+{
+    // select cascade by the view space depth
+    float depth = -(u_view * vec4(worldPos, 1.0)).z;
+    int layer = -1;
+    for(int i = 0; i < u_cascadeNum; ++i)
+    {
+        if(depth < u_cascadeSplits[i])
+        {
+            layer = i;
+            break;
+        }
+    }
+    if(layer < 0)
+        return 0.0;
+
+    vec4 fragPosLightSpace = u_cascadeSpace[layer] * vec4(worldPos, 1.0);
+    vec3 projCoords = fragPosLightSpace.xyz / fragPosLightSpace.w;
+    projCoords = projCoords * 0.5 + 0.5;
+    if(projCoords.z > 1.0)
+        return 0.0;
+
+    float currentDepth = projCoords.z;
+    float bias = max(0.005 * (1.0 - dot(normal, lightDir)), 0.0005);
+
+    // PCF
+    float shadow = 0.0;
+    vec2 texelSize = 1.0 / vec2(textureSize(u_shadowCascades, 0).xy);
+    for(int x = -1; x <= 1; ++x)
+    {
+        for(int y = -1; y <= 1; ++y)
+        {
+            float pcfDepth = texture(u_shadowCascades, vec3(projCoords.xy + vec2(x, y) * texelSize, layer)).r;
+            shadow += currentDepth - bias > pcfDepth  ? 1.0 : 0.0;
+        }
+    }
+    shadow /= 9.0;
+    return shadow;
+}
+// ----------------------------------------------------------------------------
 // Easy trick to get tangent-normals to world-space to keep PBR code simplified.
 // Don't worry if you don't get what's going on; you generally want to do normal 
 // mapping the usual way for performance anways; I do plan make a note of this 
@@ -279,6 +329,12 @@ void main()
     float mat_metallic  = u_mat_attrib[fs_materialID].x;
     float mat_roughness = u_mat_attrib[fs_materialID].y;
 
+    // instanced primitives have their own color
+    if(u_use_instance)
+    {
+        mat_color = fs_instanceColor.rgb;
+    }
+
     // set normal
     vec3 N = normalize(fs_normal);
     vec3 V = normalize(u_viewPosition - fs_worldPos);
@@ -433,7 +489,8 @@ void main()
     //ambient = 0.5 * ambient + 0.5 * vec3(0.03) * albedo * ao;
 #endif
     vec3 lightDir = normalize(u_lightDirection);
-    float shadow = ShadowCalculation(fs_lightSpacePos, N, lightDir, u_shadowMap);
+    float shadow = (u_cascadeNum > 0) ? CascadeShadowCalculation(fs_worldPos, N, lightDir)
+                                      : ShadowCalculation(fs_lightSpacePos, N, lightDir, u_shadowMap);
     shadow = clamp(shadow, 0.0, 1.0);
 
     float gridWeight = 0.0f;
@@ -1,10 +1,12 @@
 #version 330 core
-layout (location = 0) in vec3 a_position;
+layout (location = 0) in vec4 a_position;   // w: bitangent sign of PackedVertexGL
 layout (location = 1) in vec3 a_normal;
 layout (location = 2) in vec2 a_uv;
 layout (location = 3) in vec3 a_tangent;
 layout (location = 4) in vec3 a_bitangent;
 layout (location = 5) in vec3 a_materialID;
+layout (location = 8) in mat4 a_instanceModel;   // 8 ~ 11
+layout (location = 12) in vec4 a_instanceColor;
 // uniforms ----------------------------------------------------- //
 uniform mat4 u_projection;
 uniform mat4 u_view;
@@ -12,6 +14,10 @@ uniform mat4 u_model;
 //uniform vec3 u_viewPosition;
 //uniform vec3 u_lightDirection;
 uniform mat4 u_lightSpace;
+uniform bool u_packed;            // PackedVertexGL
+uniform vec3 u_position_offset;
+uniform vec3 u_position_scale;
+uniform bool u_use_instance;
 // -------------------------------------------------------------- //
 // output
 out vec2 fs_uv;
@@ -21,16 +27,43 @@ out vec3 fs_tangent;
 out vec3 fs_bitangent;
 out vec4 fs_lightSpacePos;
 flat out int fs_materialID;
+out vec4 fs_instanceColor;
+// -------------------------------------------------------------- //
+// PackedVertexGL ----------------------------------------------- //
+vec3 oct_decode(vec2 e)
+{
+    vec3 v = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-v.z, 0.0);
+    v.x += v.x >= 0.0 ? -t : t;
+    v.y += v.y >= 0.0 ? -t : t;
+    return normalize(v);
+}
 // -------------------------------------------------------------- //
 void main()
 {
+    // unpack ======================================================= //
+    vec3 position  = a_position.xyz;
+    vec3 normal    = a_normal;
+    vec3 tangent   = a_tangent;
+    vec3 bitangent = a_bitangent;
+    if(u_packed)
+    {
+        position  = u_position_offset + u_position_scale * a_position.xyz;
+        normal    = oct_decode(a_normal.xy);
+        tangent   = oct_decode(a_tangent.xy);
+        bitangent = cross(normal, tangent) * (a_position.w > 0.5 ? 1.0 : -1.0);
+    }
+    // ============================================================== //
+    mat4 model = u_use_instance ? a_instanceModel : u_model;
+
     fs_uv = a_uv;
-    fs_worldPos = vec3(u_model * vec4(a_position, 1.0));
-    fs_normal = mat3(u_model) * a_normal;
-    fs_tangent = mat3(u_model) * a_tangent;
-    fs_bitangent = mat3(u_model) * a_bitangent;
+    fs_worldPos = vec3(model * vec4(position, 1.0));
+    fs_normal = mat3(model) * normal;
+    fs_tangent = mat3(model) * tangent;
+    fs_bitangent = mat3(model) * bitangent;
     fs_lightSpacePos = u_lightSpace * vec4(fs_worldPos, 1.0);
 
-    gl_Position = u_projection * u_view * u_model * vec4(a_position, 1.0);
+    gl_Position = u_projection * u_view * model * vec4(position, 1.0);
     fs_materialID = int(a_materialID.x);
+    fs_instanceColor = a_instanceColor;
 }
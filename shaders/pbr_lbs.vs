@@ -2,7 +2,7 @@
 const int MAX_JOINT_NUM = 100;
 uniform mat4 u_lbs_joints[MAX_JOINT_NUM];
 
-layout (location = 0) in vec3 a_position;
+layout (location = 0) in vec4 a_position;   // w: bitangent sign of PackedVertexGL
 layout (location = 1) in vec3 a_normal;
 layout (location = 2) in vec2 a_uv;
 layout (location = 3) in vec3 a_tangent;
@@ -17,6 +17,9 @@ uniform mat4 u_model;
 //uniform vec3 u_viewPosition;
 //uniform vec3 u_lightDirection;
 uniform mat4 u_lightSpace;
+uniform bool u_packed;            // PackedVertexGL
+uniform vec3 u_position_offset;
+uniform vec3 u_position_scale;
 // -------------------------------------------------------------- //
 
 // output
@@ -27,9 +30,33 @@ out vec3 fs_tangent;
 out vec3 fs_bitangent;
 out vec4 fs_lightSpacePos;
 flat out int fs_materialID;
+out vec4 fs_instanceColor;   // not instanced
 
+// PackedVertexGL ----------------------------------------------- //
+vec3 oct_decode(vec2 e)
+{
+    vec3 v = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-v.z, 0.0);
+    v.x += v.x >= 0.0 ? -t : t;
+    v.y += v.y >= 0.0 ? -t : t;
+    return normalize(v);
+}
+// -------------------------------------------------------------- //
 void main()
 {
+    // unpack ======================================================= //
+    vec3 position  = a_position.xyz;
+    vec3 normal    = a_normal;
+    vec3 tangent   = a_tangent;
+    vec3 bitangent = a_bitangent;
+    if(u_packed)
+    {
+        position  = u_position_offset + u_position_scale * a_position.xyz;
+        normal    = oct_decode(a_normal.xy);
+        tangent   = oct_decode(a_tangent.xy);
+        bitangent = cross(normal, tangent) * (a_position.w > 0.5 ? 1.0 : -1.0);
+    }
+    // ============================================================== //
     // Linear Blend Skining ========================================= //
     int jidx0 = int(a_lbs_jointIDs.x);
     int jidx1 = int(a_lbs_jointIDs.y);
@@ -43,12 +70,13 @@ void main()
     // ============================================================== //
 
     fs_uv = a_uv;
-    fs_worldPos = vec3(lbs_model * vec4(a_position, 1.0));
-    fs_normal = mat3(lbs_model) * a_normal;
-    fs_tangent = mat3(lbs_model) * a_tangent;
-    fs_bitangent = mat3(lbs_model) * a_bitangent;
+    fs_worldPos = vec3(lbs_model * vec4(position, 1.0));
+    fs_normal = mat3(lbs_model) * normal;
+    fs_tangent = mat3(lbs_model) * tangent;
+    fs_bitangent = mat3(lbs_model) * bitangent;
     fs_lightSpacePos = u_lightSpace * vec4(fs_worldPos, 1.0);
     
-    gl_Position = u_projection * u_view * lbs_model * vec4(a_position, 1.0);
+    gl_Position = u_projection * u_view * lbs_model * vec4(position, 1.0);
     fs_materialID = int(a_materialID.x);
+    fs_instanceColor = vec4(1.0);
 }
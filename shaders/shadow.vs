@@ -2,7 +2,7 @@
 const int MAX_JOINT_NUM = 100;
 uniform mat4 u_lbs_joints[MAX_JOINT_NUM];
 
-layout (location = 0) in vec3 a_position;
+layout (location = 0) in vec4 a_position;   // w: bitangent sign of PackedVertexGL
 layout (location = 1) in vec3 a_normal;
 layout (location = 2) in vec2 a_uv;
 layout (location = 3) in vec3 a_tangent;
@@ -10,14 +10,21 @@ layout (location = 4) in vec3 a_bitangent;
 layout (location = 5) in vec3 a_materialID;
 layout (location = 6) in vec4 a_lbs_jointIDs;
 layout (location = 7) in vec4 a_lbs_weights;
+layout (location = 8) in mat4 a_instanceModel;   // 8 ~ 11
 
 // uniforms
 uniform bool u_use_lbs;
+uniform bool u_use_instance;
 uniform mat4 u_model;
 uniform mat4 u_lightSpace;
+uniform bool u_packed;            // PackedVertexGL
+uniform vec3 u_position_offset;
+uniform vec3 u_position_scale;
 
 void main()
 {
+    vec3 position = u_packed ? u_position_offset + u_position_scale * a_position.xyz : a_position.xyz;
+
     if(u_use_lbs)
     {
         // Linear Blend Skining ========================================= //
@@ -32,10 +39,11 @@ void main()
                        + a_lbs_weights.w * u_lbs_joints[jidx3];
         // ============================================================== //
 
-        gl_Position = u_lightSpace * lbs_model * vec4(a_position, 1.0);
+        gl_Position = u_lightSpace * lbs_model * vec4(position, 1.0);
     }
     else
     {
-        gl_Position = u_lightSpace * u_model * vec4(a_position, 1.0);
+        mat4 model = u_use_instance ? a_instanceModel : u_model;
+        gl_Position = u_lightSpace * model * vec4(position, 1.0);
     }
 }